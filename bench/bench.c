@@ -0,0 +1,104 @@
+/**********************************************************************************************
+*
+*   raylib_networking_smaple * a sample network game using raylib and enet
+*
+*   LICENSE: ZLIB
+*
+*   Copyright (c) 2023 Jeffery Myers
+*
+*   Permission is hereby granted, free of charge, to any person obtaining a copy
+*   of this software and associated documentation files (the "Software"), to deal
+*   in the Software without restriction, including without limitation the rights
+*   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*   copies of the Software, and to permit persons to whom the Software is
+*   furnished to do so, subject to the following conditions:
+*
+*   The above copyright notice and this permission notice shall be included in all
+*   copies or substantial portions of the Software.
+*
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*   SOFTWARE.
+*
+**********************************************************************************************/
+
+// microbenchmarks for the hot paths of the client
+// every benchmark is a command, "bench memory ..." runs the memory backend benchmark and "bench codec" the car codec
+
+#define ENET_IMPLEMENTATION
+#include "net_common.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// a timed run has to take at least this long (microseconds) before we trust the clock
+#define BENCH_MIN_RUN 100000
+
+// the slowest backends take milliseconds a call, don't double forever
+#define BENCH_MAX_ITERATIONS (1u << 30)
+
+static volatile uint8_t Sink = 0;
+
+void BenchKeep(const void* data, uint32_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint8_t sum = 0;
+	for (uint32_t i = 0; i < size; i++)
+		sum ^= bytes[i];
+	Sink ^= sum;
+}
+
+double BenchTime(BenchBody body, void* ctx)
+{
+	// one untimed run, so first touches of memory and lazy setup don't count
+	body(ctx, 1);
+
+	uint32_t iterations = 1;
+	for (;;)
+	{
+		uint64_t start = NetTimeMicros();
+		body(ctx, iterations);
+		uint64_t elapsed = NetTimeMicros() - start;
+
+		if (elapsed >= BENCH_MIN_RUN || iterations >= BENCH_MAX_ITERATIONS)
+			return (double)elapsed * 1000.0 / (double)iterations;
+
+		// aim a little past the minimum so the next run is usually the last
+		if (elapsed == 0)
+			iterations *= 16;
+		else
+		{
+			uint64_t next = (uint64_t)iterations * BENCH_MIN_RUN * 3 / (elapsed * 2) + 1;
+			iterations = next > BENCH_MAX_ITERATIONS ? BENCH_MAX_ITERATIONS : (uint32_t)next;
+		}
+	}
+}
+
+static void PrintUsage(void)
+{
+	printf("usage: bench memory [-backend name] [-write]\n");
+	printf("       bench codec [-check]\n");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (strcmp(argv[1], "memory") == 0)
+		return MemoryBench(argc - 1, argv + 1);
+	if (strcmp(argv[1], "codec") == 0)
+		return CodecBench(argc - 1, argv + 1);
+
+	PrintUsage();
+	return 1;
+}
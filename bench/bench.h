@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+// runs a benchmark body this many times, ctx is whatever the benchmark needs
+typedef void (*BenchBody)(void* ctx, uint32_t iterations);
+
+// how long one iteration of body takes, in nanoseconds
+// the body is run with more and more iterations until a run takes long enough to time
+double BenchTime(BenchBody body, void* ctx);
+
+// stops the compiler from throwing away work whose result is never used
+void BenchKeep(const void* data, uint32_t size);
+
+int MemoryBench(int argc, char** argv);
+int CodecBench(int argc, char** argv);
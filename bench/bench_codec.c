@@ -0,0 +1,334 @@
+// car codec benchmark
+// times packing and unpacking one car three ways:
+//   floats  the old layout, six floats and three bytes, through the byte packet reader and writer
+//   bits    the same floats and bytes through the bitstream, to compare the readers on the same data
+//   codec   the quantized car (net_car_codec.h), what goes on the wire now
+// and prints the bytes a car takes and the worst error of the codec over the cars it packed.
+// "bench codec -check" skips the timing and round trips a million cars instead, it fails if any car in range comes back
+// further off than the error budget in net_car_codec.h or if the clamp counts are wrong.
+
+#include "net_common.h"
+#include "net_bitstream.h"
+#include "net_car_codec.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+// cars to cycle through, enough that the branch predictor can't learn the values
+#define CODEC_CARS 1024
+
+// six floats and three bytes
+#define FLOAT_CAR_SIZE 27
+
+// cars the check round trips
+#define CHECK_CARS 1000000
+
+typedef struct
+{
+	CarState Cars[CODEC_CARS];
+	CarState Decoded[CODEC_CARS];
+	uint8_t Wire[CODEC_CARS][FLOAT_CAR_SIZE];
+}CodecBenchState;
+
+static float RandomRange(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// the old layout through the packet writer, on a packet that lives on the stack
+static void FloatsEncodeBody(void* ctx, uint32_t iterations)
+{
+	CodecBenchState* state = (CodecBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t index = i & (CODEC_CARS - 1);
+		const CarState* car = &state->Cars[index];
+
+		ENetPacket packet = { 0 };
+		packet.data = state->Wire[index];
+		PacketWriter writer = { &packet, 0, FLOAT_CAR_SIZE, false };
+		PacketWriteFloat(&writer, car->X);
+		PacketWriteFloat(&writer, car->Y);
+		PacketWriteFloat(&writer, car->Z);
+		PacketWriteFloat(&writer, car->Pitch);
+		PacketWriteFloat(&writer, car->Yaw);
+		PacketWriteFloat(&writer, car->Speed);
+		PacketWriteByte(&writer, car->BrakeLight);
+		PacketWriteByte(&writer, car->Car);
+		PacketWriteByte(&writer, car->CarNumber);
+	}
+}
+
+static void FloatsDecodeBody(void* ctx, uint32_t iterations)
+{
+	CodecBenchState* state = (CodecBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t index = i & (CODEC_CARS - 1);
+		CarState* car = &state->Decoded[index];
+
+		PacketReader reader = { state->Wire[index], FLOAT_CAR_SIZE, 0, false };
+		car->X = PacketReadFloat(&reader);
+		car->Y = PacketReadFloat(&reader);
+		car->Z = PacketReadFloat(&reader);
+		car->Pitch = PacketReadFloat(&reader);
+		car->Yaw = PacketReadFloat(&reader);
+		car->Speed = PacketReadFloat(&reader);
+		car->BrakeLight = PacketReadByte(&reader);
+		car->Car = PacketReadByte(&reader);
+		car->CarNumber = PacketReadByte(&reader);
+	}
+	BenchKeep(state->Decoded, sizeof(CarState));
+}
+
+static void WriteFloatBits(BitWriter* writer, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	BitWriteBits(writer, bits, 32);
+}
+
+static float ReadFloatBits(BitReader* reader)
+{
+	uint32_t bits = BitReadBits(reader, 32);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void BitsEncodeBody(void* ctx, uint32_t iterations)
+{
+	CodecBenchState* state = (CodecBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t index = i & (CODEC_CARS - 1);
+		const CarState* car = &state->Cars[index];
+
+		BitWriter writer;
+		BitWriterInit(&writer, state->Wire[index], FLOAT_CAR_SIZE);
+		WriteFloatBits(&writer, car->X);
+		WriteFloatBits(&writer, car->Y);
+		WriteFloatBits(&writer, car->Z);
+		WriteFloatBits(&writer, car->Pitch);
+		WriteFloatBits(&writer, car->Yaw);
+		WriteFloatBits(&writer, car->Speed);
+		BitWriteBits(&writer, car->BrakeLight, 8);
+		BitWriteBits(&writer, car->Car, 8);
+		BitWriteBits(&writer, car->CarNumber, 8);
+		BitWriterFinish(&writer);
+	}
+}
+
+static void BitsDecodeBody(void* ctx, uint32_t iterations)
+{
+	CodecBenchState* state = (CodecBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t index = i & (CODEC_CARS - 1);
+		CarState* car = &state->Decoded[index];
+
+		BitReader reader;
+		BitReaderInit(&reader, state->Wire[index], FLOAT_CAR_SIZE);
+		car->X = ReadFloatBits(&reader);
+		car->Y = ReadFloatBits(&reader);
+		car->Z = ReadFloatBits(&reader);
+		car->Pitch = ReadFloatBits(&reader);
+		car->Yaw = ReadFloatBits(&reader);
+		car->Speed = ReadFloatBits(&reader);
+		car->BrakeLight = (uint8_t)BitReadBits(&reader, 8);
+		car->Car = (uint8_t)BitReadBits(&reader, 8);
+		car->CarNumber = (uint8_t)BitReadBits(&reader, 8);
+		BitReaderOverflow(&reader);
+	}
+	BenchKeep(state->Decoded, sizeof(CarState));
+}
+
+static void CodecEncodeBody(void* ctx, uint32_t iterations)
+{
+	CodecBenchState* state = (CodecBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t index = i & (CODEC_CARS - 1);
+		EncodeCarMotion(&state->Cars[index], state->Wire[index]);
+		EncodeCarIdentity(&state->Cars[index], state->Wire[index] + CAR_MOTION_SIZE);
+	}
+}
+
+static void CodecDecodeBody(void* ctx, uint32_t iterations)
+{
+	CodecBenchState* state = (CodecBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t index = i & (CODEC_CARS - 1);
+		DecodeCarMotion(state->Wire[index], &state->Decoded[index]);
+		DecodeCarIdentity(state->Wire[index] + CAR_MOTION_SIZE, &state->Decoded[index]);
+	}
+	BenchKeep(state->Decoded, sizeof(CarState));
+}
+
+static float AngleError(float a, float b)
+{
+	float error = fmodf(fabsf(a - b), 6.2831853f);
+	return error > 3.1415927f ? 6.2831853f - error : error;
+}
+
+// the error can go past the budget by the rounding of the float itself
+static bool OverBudget(float error, float budget, float value)
+{
+	return error > budget + fabsf(value) * FLT_EPSILON * 2;
+}
+
+// a car anywhere in the codec's ranges, edges included
+static void RandomCarInRange(CarState* car)
+{
+	car->X = RandomRange(-4096.0f, 4096.0f - 1.0f / 32.0f);
+	car->Y = RandomRange(-128.0f, 128.0f - 1.0f / 16.0f);
+	car->Z = RandomRange(-4096.0f, 4096.0f - 1.0f / 32.0f);
+	car->Pitch = RandomRange(-0.785f, 0.783f);
+	car->Yaw = RandomRange(-6.28f, 6.28f);
+	car->Speed = RandomRange(0, 511.5f);
+	car->BrakeLight = (uint8_t)(rand() & 1);
+	car->Car = (uint8_t)(rand() & 7);
+	car->CarNumber = (uint8_t)rand();
+}
+
+static int CodecCheck(void)
+{
+	srand(2);
+	CarCodecClamps before;
+	CarCodecGetClamps(&before);
+
+	uint32_t failures = 0;
+	float position = 0, height = 0, angle = 0, speed = 0;
+	for (int i = 0; i < CHECK_CARS; i++)
+	{
+		CarState car = { 0 };
+		RandomCarInRange(&car);
+
+		CarState decoded = car;
+		QuantizeCarState(&decoded);
+
+		float errorX = fabsf(car.X - decoded.X);
+		float errorZ = fabsf(car.Z - decoded.Z);
+		float errorY = fabsf(car.Y - decoded.Y);
+		float errorYaw = AngleError(car.Yaw, decoded.Yaw);
+		float errorPitch = fabsf(car.Pitch - decoded.Pitch);
+		float errorSpeed = fabsf(car.Speed - decoded.Speed);
+		position = fmaxf(position, fmaxf(errorX, errorZ));
+		height = fmaxf(height, errorY);
+		angle = fmaxf(angle, fmaxf(errorYaw, errorPitch));
+		speed = fmaxf(speed, errorSpeed);
+
+		bool bad = OverBudget(errorX, CAR_ERROR_XZ, car.X) || OverBudget(errorZ, CAR_ERROR_XZ, car.Z) || OverBudget(errorY, CAR_ERROR_Y, car.Y) ||
+			OverBudget(errorYaw, CAR_ERROR_ANGLE, car.Yaw) || OverBudget(errorPitch, CAR_ERROR_ANGLE, car.Pitch) || OverBudget(errorSpeed, CAR_ERROR_SPEED, car.Speed) ||
+			decoded.BrakeLight != car.BrakeLight || decoded.Car != car.Car || decoded.CarNumber != car.CarNumber;
+
+		// a car that came off the wire is in range, the server packs it again for every snapshot
+		CarState again = decoded;
+		QuantizeCarState(&again);
+		bad = bad || memcmp(&again, &decoded, sizeof(CarState)) != 0;
+
+		if (bad && failures++ < 10)
+			printf("over budget: X %f Y %f Z %f pitch %f yaw %f speed %f came back as X %f Y %f Z %f pitch %f yaw %f speed %f\n",
+				car.X, car.Y, car.Z, car.Pitch, car.Yaw, car.Speed, decoded.X, decoded.Y, decoded.Z, decoded.Pitch, decoded.Yaw, decoded.Speed);
+	}
+
+	printf("%d cars, worst error X/Z %.4f (budget %.4f) Y %.4f (%.4f) angles %.5f (%.5f) rad speed %.3f (%.3f)\n", CHECK_CARS,
+		position, CAR_ERROR_XZ, height, CAR_ERROR_Y, angle, CAR_ERROR_ANGLE, speed, CAR_ERROR_SPEED);
+
+	// nothing in range may be counted as clamped
+	CarCodecClamps after;
+	CarCodecGetClamps(&after);
+	if (memcmp(&before, &after, sizeof(CarCodecClamps)) != 0)
+	{
+		printf("cars in range were counted as clamped\n");
+		failures++;
+	}
+
+	// and every value out of range is, and sticks to the edge
+	CarState outside = { 0 };
+	outside.X = 5000;
+	outside.Z = -5000;
+	outside.Y = 200;
+	outside.Pitch = 1.5f;
+	outside.Yaw = 360;
+	outside.Speed = 600;
+	QuantizeCarState(&outside);
+	CarCodecGetClamps(&after);
+	if (after.Position - before.Position != 2 || after.Height - before.Height != 1 || after.Pitch - before.Pitch != 1 ||
+		after.Speed - before.Speed != 1 || after.YawTurns - before.YawTurns != 1)
+	{
+		printf("out of range values were not all counted\n");
+		failures++;
+	}
+	if (outside.X < 4095 || outside.Z > -4095 || outside.Y < 127 || outside.Speed < 511)
+	{
+		printf("out of range values did not stick to the edge\n");
+		failures++;
+	}
+
+	printf(failures == 0 ? "codec check passed\n" : "codec check FAILED\n");
+	return failures == 0 ? 0 : 1;
+}
+
+int CodecBench(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "-check") == 0)
+		return CodecCheck();
+
+	CodecBenchState* state = (CodecBenchState*)calloc(1, sizeof(CodecBenchState));
+	if (state == NULL)
+		return 1;
+
+	// cars all over a course, at racing speeds
+	srand(1);
+	for (int i = 0; i < CODEC_CARS; i++)
+	{
+		CarState* car = &state->Cars[i];
+		car->X = RandomRange(-3000, 3000);
+		car->Y = RandomRange(-60, 60);
+		car->Z = RandomRange(-3000, 3000);
+		car->Pitch = RandomRange(-0.3f, 0.3f);
+		car->Yaw = RandomRange(-3.1415f, 3.1415f);
+		car->Speed = RandomRange(0, 330);
+		car->BrakeLight = (uint8_t)(rand() & 1);
+		car->Car = (uint8_t)(rand() & 7);
+		car->CarNumber = (uint8_t)rand();
+	}
+
+	printf("%-8s %6s %12s %12s\n", "", "bytes", "encode ns", "decode ns");
+
+	double encode = BenchTime(FloatsEncodeBody, state);
+	double decode = BenchTime(FloatsDecodeBody, state);
+	printf("%-8s %6d %12.1f %12.1f\n", "floats", FLOAT_CAR_SIZE, encode, decode);
+
+	encode = BenchTime(BitsEncodeBody, state);
+	decode = BenchTime(BitsDecodeBody, state);
+	printf("%-8s %6d %12.1f %12.1f\n", "bits", FLOAT_CAR_SIZE, encode, decode);
+
+	encode = BenchTime(CodecEncodeBody, state);
+	decode = BenchTime(CodecDecodeBody, state);
+	printf("%-8s %6d %12.1f %12.1f\n", "codec", CAR_MOTION_SIZE + CAR_IDENTITY_SIZE, encode, decode);
+
+	// the wire holds the codec's cars from the last run
+	CodecDecodeBody(state, CODEC_CARS);
+	float position = 0, height = 0, angle = 0, speed = 0;
+	for (int i = 0; i < CODEC_CARS; i++)
+	{
+		const CarState* car = &state->Cars[i];
+		const CarState* decoded = &state->Decoded[i];
+		position = fmaxf(position, fmaxf(fabsf(car->X - decoded->X), fabsf(car->Z - decoded->Z)));
+		height = fmaxf(height, fabsf(car->Y - decoded->Y));
+		angle = fmaxf(angle, fmaxf(AngleError(car->Yaw, decoded->Yaw), fabsf(car->Pitch - decoded->Pitch)));
+		speed = fmaxf(speed, fabsf(car->Speed - decoded->Speed));
+	}
+	printf("codec error, X/Z %.4f Y %.4f angles %.5f rad speed %.3f\n", position, height, angle, speed);
+
+	free(state);
+	return 0;
+}
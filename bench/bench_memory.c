@@ -0,0 +1,223 @@
+// memory backend benchmark
+// for every backend that attaches, times single reads, block reads of growing size and the gather of a
+// frame's worth of car fields, then fits the block reads to a cost per call plus a cost per byte.
+// with -write the same is done for writes, writing back what was just read so the game sees no change.
+//
+// the process backends need something to attach to, run fakemodel (or the emulator) first and give
+// the bench the same SCUD_* environment the client would get.
+
+#include "memory.h"
+#include "scudplus.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// block reads start here, the game's system block, which every backend can reach
+#define BENCH_ADDR gSystemBlock
+
+// block sizes to time, the fit needs a spread from one field to far more than a frame reads
+static const uint32_t BlockSizes[] = { 4, 16, 64, 256, 1024, 4096, 16384, 65536 };
+#define BLOCK_SIZE_COUNT (sizeof(BlockSizes) / sizeof(BlockSizes[0]))
+#define BLOCK_MAX 65536
+
+// a frame of remote car fields, like the client writes: 8 cars with 10 fields of 4 bytes
+#define FIELD_CARS 8
+#define FIELD_PER_CAR 10
+#define FIELD_COUNT (FIELD_CARS * FIELD_PER_CAR)
+
+static const uint32_t FieldOffsets[FIELD_PER_CAR] = { bXPos, bYPos, bZPos, bPitch, bYaw, bSpeed, bBrakeLight, bCarType, bCarNumber, bAIAccel };
+
+typedef struct
+{
+	uint32_t Size;
+	uint8_t Buffer[BLOCK_MAX];
+	MEM_ReadSpan ReadSpans[FIELD_COUNT];
+	MEM_Span WriteSpans[FIELD_COUNT];
+	uint8_t Fields[FIELD_COUNT][4];
+}MemoryBenchState;
+
+static struct
+{
+	const char* Backend;
+	bool Write;
+}Config;
+
+static void ReadBlockBody(void* ctx, uint32_t iterations)
+{
+	MemoryBenchState* state = (MemoryBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+		MEM_ReadBlock(BENCH_ADDR, state->Buffer, state->Size);
+	BenchKeep(state->Buffer, 4);
+}
+
+static void WriteBlockBody(void* ctx, uint32_t iterations)
+{
+	MemoryBenchState* state = (MemoryBenchState*)ctx;
+	MEM_Span span = { BENCH_ADDR, state->Buffer, state->Size };
+	for (uint32_t i = 0; i < iterations; i++)
+		MEM_WriteSpans(&span, 1);
+}
+
+static void ReadFieldsBody(void* ctx, uint32_t iterations)
+{
+	MemoryBenchState* state = (MemoryBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		for (uint32_t f = 0; f < FIELD_COUNT; f++)
+			MEM_ReadBlock(state->ReadSpans[f].Addr, state->Fields[f], 4);
+	}
+	BenchKeep(state->Fields, sizeof(state->Fields));
+}
+
+static void GatherFieldsBody(void* ctx, uint32_t iterations)
+{
+	MemoryBenchState* state = (MemoryBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+		MEM_ReadSpans(state->ReadSpans, FIELD_COUNT);
+	BenchKeep(state->Fields, sizeof(state->Fields));
+}
+
+static void WriteFieldsBody(void* ctx, uint32_t iterations)
+{
+	MemoryBenchState* state = (MemoryBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		for (uint32_t f = 0; f < FIELD_COUNT; f++)
+			MEM_WriteSpans(&state->WriteSpans[f], 1);
+	}
+}
+
+static void ScatterFieldsBody(void* ctx, uint32_t iterations)
+{
+	MemoryBenchState* state = (MemoryBenchState*)ctx;
+	for (uint32_t i = 0; i < iterations; i++)
+		MEM_WriteSpans(state->WriteSpans, FIELD_COUNT);
+}
+
+//==========================================================================
+// Purpose: time one body over every block size and split the cost into a
+// part per call and a part per byte
+// the per byte cost is the slope from the smallest to the biggest block, the
+// per call cost is what is left of the smallest block. a least squares fit
+// over all sizes is dominated by the big blocks and gets the per call cost wrong
+//==========================================================================
+static void BenchBlocks(const char* label, BenchBody body, MemoryBenchState* state)
+{
+	double times[BLOCK_SIZE_COUNT];
+
+	printf("  %-6s", label);
+	for (uint32_t i = 0; i < BLOCK_SIZE_COUNT; i++)
+	{
+		state->Size = BlockSizes[i];
+		times[i] = BenchTime(body, state);
+		printf(" %9.1f", times[i]);
+	}
+
+	const uint32_t last = BLOCK_SIZE_COUNT - 1;
+	double perByte = (times[last] - times[0]) / (double)(BlockSizes[last] - BlockSizes[0]);
+	double perCall = times[0] - perByte * BlockSizes[0];
+	printf("\n  %-6s %.1f ns per call + %.3f ns per byte\n", "", perCall, perByte);
+}
+
+static void BenchBackend(const MEM_Backend* backend, MemoryBenchState* state)
+{
+	printf("%s\n", backend->Name);
+
+	MEM_SetBackend(backend);
+	if (!MEM_Init())
+	{
+		printf("  could not attach, is the emulator or fakemodel running?\n");
+		return;
+	}
+	MEM_UpdateEmuoffset();
+
+	if (!MEM_ReadBlock(BENCH_ADDR, state->Buffer, BLOCK_MAX))
+	{
+		printf("  attached, but could not read emulated RAM\n");
+		MEM_Quit();
+		return;
+	}
+
+	// the fields of every car, with what is there now, so writing them back changes nothing
+	for (uint32_t c = 0; c < FIELD_CARS; c++)
+	{
+		for (uint32_t f = 0; f < FIELD_PER_CAR; f++)
+		{
+			uint32_t index = c * FIELD_PER_CAR + f;
+			uint32_t addr = pBase[c] + FieldOffsets[f];
+			state->ReadSpans[index] = (MEM_ReadSpan){ addr, state->Fields[index], 4 };
+			state->WriteSpans[index] = (MEM_Span){ addr, state->Fields[index], 4 };
+		}
+	}
+	MEM_ReadSpans(state->ReadSpans, FIELD_COUNT);
+
+	printf("  %-6s", "bytes");
+	for (uint32_t i = 0; i < BLOCK_SIZE_COUNT; i++)
+		printf(" %9u", BlockSizes[i]);
+	printf("  (ns per call)\n");
+
+	BenchBlocks("read", ReadBlockBody, state);
+	if (Config.Write)
+		BenchBlocks("write", WriteBlockBody, state);
+
+	printf("  %d car fields: %.1f ns one by one, %.1f ns gathered\n", FIELD_COUNT, BenchTime(ReadFieldsBody, state), BenchTime(GatherFieldsBody, state));
+	if (Config.Write)
+		printf("  %d car fields: %.1f ns written one by one, %.1f ns scattered\n", FIELD_COUNT, BenchTime(WriteFieldsBody, state), BenchTime(ScatterFieldsBody, state));
+
+	MEM_Quit();
+}
+
+static bool ParseArgs(int argc, char** argv)
+{
+	Config.Backend = NULL;
+	Config.Write = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-write") == 0)
+		{
+			Config.Write = true;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+			return false;
+
+		const char* value = argv[++i];
+		if (strcmp(argv[i - 1], "-backend") == 0)
+			Config.Backend = value;
+		else
+			return false;
+	}
+
+	return Config.Backend == NULL || MEM_FindBackend(Config.Backend) != NULL;
+}
+
+int MemoryBench(int argc, char** argv)
+{
+	if (!ParseArgs(argc, argv))
+	{
+		printf("usage: bench memory [-backend");
+		for (int i = 0; MEM_Backends[i] != NULL; i++)
+			printf("%s%s", i == 0 ? " " : "|", MEM_Backends[i]->Name);
+		printf("] [-write]\n");
+		return 1;
+	}
+
+	MemoryBenchState* state = (MemoryBenchState*)calloc(1, sizeof(MemoryBenchState));
+	if (state == NULL)
+		return 1;
+
+	for (int i = 0; MEM_Backends[i] != NULL; i++)
+	{
+		if (Config.Backend == NULL || strcmp(Config.Backend, MEM_Backends[i]->Name) == 0)
+			BenchBackend(MEM_Backends[i], state);
+	}
+
+	free(state);
+	return 0;
+}
@@ -38,6 +38,7 @@
 // we can't directly include networking in any file that uses raylib.h, so we abstract out the network gameplay to it's own file
 #include "net_client.h"
 #include "net_constants.h"
+#include "net_car_codec.h"
 
 // a list of predefined colors based on the player lost
 Color PlayerColors[MAX_PLAYERS] = { 0 };
@@ -97,6 +98,10 @@ int main()
 			connected = false;
 		}
 
+		// F2 switches how remote cars are smoothed, to compare the two
+		if (IsKeyPressed(KEY_F2))
+			SetSmoothingMode(GetSmoothingMode() == SmoothingInterpolate ? SmoothingExtrapolate : SmoothingInterpolate);
+
 		// let the network game system update
 		// this will process any inbound events and update the local simulation
 		Update(GetTime(), GetFrameTime());
@@ -116,6 +121,13 @@ int main()
 		{
 			// we are connected, and know what our player ID is, so show that to the player in our color
 			DrawText(TextFormat("Player %d", GetLocalPlayerId()), 0, 20, 20, PlayerColors[GetLocalPlayerId()]);
+			DrawText(GetSmoothingMode() == SmoothingInterpolate ? "Interpolate (F2)" : "Extrapolate (F2)", 0, 100, 10, GRAY);
+
+			// values our car had that didn't fit the wire format, see net_car_codec.h
+			CarCodecClamps clamps;
+			CarCodecGetClamps(&clamps);
+			if (clamps.Position + clamps.Height + clamps.Pitch + clamps.Speed + clamps.YawTurns > 0)
+				DrawText(TextFormat("Clamped X/Z %u Y %u pitch %u speed %u, yaw past a turn %u", clamps.Position, clamps.Height, clamps.Pitch, clamps.Speed, clamps.YawTurns), 0, 110, 10, ORANGE);
 			//DrawText(TextFormat("Laps %d", off), 0, 40, 20, BLUE);
 			Vector3 pos; 
 			Vector3 pos2;
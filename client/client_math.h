@@ -0,0 +1,13 @@
+// small math helpers shared by the client's smoothing code, in the style of raymath
+#pragma once
+
+#include <math.h>
+
+#include "raymath.h"
+
+// bring an angle difference back into -PI to PI, so turning through the wrap point isn't a full circle
+// an infinite angle comes back as NaN instead of spinning a loop forever
+static inline float WrapAngle(float angle)
+{
+	return remainderf(angle, 2 * PI);
+}
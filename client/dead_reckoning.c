@@ -0,0 +1,149 @@
+// dead reckoning for remote cars
+
+#include "dead_reckoning.h"
+#include "client_math.h"
+
+#include <math.h>
+#include <string.h>
+
+static float ClampFloat(float value, float min, float max)
+{
+	if (value < min)
+		return min;
+	if (value > max)
+		return max;
+	return value;
+}
+
+// turn a vector around the up axis
+static Vector3 RotateFlat(Vector3 v, float angle)
+{
+	float c = cosf(angle);
+	float s = sinf(angle);
+	return (Vector3){ v.x * c - v.z * s, v.y, v.x * s + v.z * c };
+}
+
+// where the car is predicted to be, not counting the correction
+static Vector3 PredictRaw(const DeadReckoning* motion, float time)
+{
+	// driving straight
+	float turn = motion->TurnRate * time;
+	if (fabsf(turn) < 0.001f)
+		return Vector3Add(motion->Position, Vector3Scale(motion->Velocity, time));
+
+	// driving along an arc, this is the velocity turning at TurnRate added up over the time
+	float along = sinf(turn) / motion->TurnRate;
+	float across = (1 - cosf(turn)) / motion->TurnRate;
+
+	Vector3 move;
+	move.x = motion->Velocity.x * along - motion->Velocity.z * across;
+	move.y = motion->Velocity.y * time;
+	move.z = motion->Velocity.z * along + motion->Velocity.x * across;
+	return Vector3Add(motion->Position, move);
+}
+
+// how long ago the newest state was, limited to how far we are willing to predict
+static float PredictTime(const DeadReckoning* motion, double now)
+{
+	return ClampFloat((float)(now - motion->ReceiveTime), 0, (float)DEAD_RECKONING_MAX_TIME);
+}
+
+void DeadReckoningReset(DeadReckoning* motion)
+{
+	memset(motion, 0, sizeof(DeadReckoning));
+}
+
+void DeadReckoningAddState(DeadReckoning* motion, Vector3 position, float yaw, float speed, uint32_t sampleTime, double now)
+{
+	// the server repeats a car's state in every snapshot until the owner sends a new one
+	if (motion->Valid && sampleTime != 0 && sampleTime == motion->SampleTime)
+		return;
+
+	if (motion->Valid && sampleTime == 0 && memcmp(&position, &motion->Position, sizeof(Vector3)) == 0 && yaw == motion->Yaw)
+		return;
+
+	// the first state, there is nothing to work out the movement from yet
+	if (!motion->Valid)
+	{
+		DeadReckoningReset(motion);
+		motion->Valid = true;
+		motion->Position = position;
+		motion->Yaw = yaw;
+		motion->Speed = speed;
+		motion->SampleTime = sampleTime;
+		motion->ReceiveTime = now;
+		return;
+	}
+
+	// where we were showing the car just before this state arrived
+	Vector3 shown;
+	float shownYaw;
+	DeadReckoningPredict(motion, now, &shown, &shownYaw);
+
+	// the time between the two states, the owner's clock is exact, the time they arrived has the network jitter in it
+	float elapsed = 0;
+	if (sampleTime != 0 && motion->SampleTime != 0)
+		elapsed = (float)(uint32_t)(sampleTime - motion->SampleTime) / 1000000.0f;
+	else
+		elapsed = (float)(now - motion->ReceiveTime);
+
+	// out of order or from long ago, we can't work out a movement from it, so the car stands still until the next one
+	if (elapsed <= 0 || elapsed > 1.0f)
+	{
+		motion->Velocity = Vector3Zero();
+		motion->TurnRate = 0;
+		motion->YawRate = 0;
+	}
+	else
+	{
+		// the average velocity between the two states
+		Vector3 velocity = Vector3Scale(Vector3Subtract(position, motion->Position), 1.0f / elapsed);
+
+		// how much the direction of travel turned since the last pair of states
+		float turnRate = 0;
+		float flatSpeed = sqrtf(velocity.x * velocity.x + velocity.z * velocity.z);
+		float oldFlatSpeed = sqrtf(motion->Velocity.x * motion->Velocity.x + motion->Velocity.z * motion->Velocity.z);
+		if (flatSpeed > 0.1f && oldFlatSpeed > 0.1f)
+		{
+			float heading = atan2f(velocity.z, velocity.x);
+			float oldHeading = atan2f(motion->Velocity.z, motion->Velocity.x);
+			turnRate = ClampFloat(WrapAngle(heading - oldHeading) / elapsed, -DEAD_RECKONING_MAX_TURN, DEAD_RECKONING_MAX_TURN);
+		}
+
+		// the average is the velocity half way between the states, turn it on to where the car is now
+		velocity = RotateFlat(velocity, turnRate * elapsed * 0.5f);
+
+		// and scale it from the average speed to the speed the game says the car is going now, so braking and accelerating carry on
+		float averageSpeed = (fabsf(speed) + fabsf(motion->Speed)) * 0.5f;
+		if (averageSpeed > 0.001f)
+			velocity = Vector3Scale(velocity, ClampFloat(fabsf(speed) / averageSpeed, 0.5f, 2.0f));
+
+		motion->Velocity = velocity;
+		motion->TurnRate = turnRate;
+
+		// the yaw is in radians, so a wrap is the car turning through PI, not spinning the other way
+		motion->YawRate = WrapAngle(yaw - motion->Yaw) / elapsed;
+	}
+
+	motion->Position = position;
+	motion->Yaw = yaw;
+	motion->Speed = speed;
+	motion->SampleTime = sampleTime;
+	motion->ReceiveTime = now;
+
+	// fade from where the car was shown to the new prediction, unless it is too far away to be the same car driving
+	motion->Correction = Vector3Subtract(shown, PredictRaw(motion, 0));
+	if (Vector3Length(motion->Correction) > DEAD_RECKONING_SNAP_DISTANCE)
+		motion->Correction = Vector3Zero();
+}
+
+void DeadReckoningPredict(const DeadReckoning* motion, double now, Vector3* position, float* yaw)
+{
+	float time = PredictTime(motion, now);
+
+	float fade = 1 - (float)(now - motion->ReceiveTime) / (float)DEAD_RECKONING_BLEND_TIME;
+	fade = ClampFloat(fade, 0, 1);
+
+	*position = Vector3Add(PredictRaw(motion, time), Vector3Scale(motion->Correction, fade));
+	*yaw = motion->Yaw + motion->YawRate * time;
+}
@@ -0,0 +1,76 @@
+// dead reckoning for remote cars
+// the server only tells us where a car was when its owner sent it, 50ms or more ago
+// this works out how the car was moving from the last two states and predicts where it is now
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "raymath.h"
+
+// never predict further ahead than this many seconds, past it the car just waits at the last prediction
+#define DEAD_RECKONING_MAX_TIME 0.25
+
+// how many seconds the gap between the old prediction and a new state is faded out over, instead of jumping
+#define DEAD_RECKONING_BLEND_TIME 0.1
+
+// a new state further than this from where we predicted the car to be is a teleport (a reset or a respawn), so we jump to it
+#define DEAD_RECKONING_SNAP_DISTANCE 20.0f
+
+// the fastest a car can turn in radians a second, anything more is noise in the positions
+#define DEAD_RECKONING_MAX_TURN 3.0f
+
+// what we know about how one remote car is moving
+typedef struct
+{
+	// true once we have a state for the car
+	bool Valid;
+
+	// the newest state
+	Vector3 Position;
+	float Yaw;
+	float Speed;
+
+	// when the owner sent the newest state (their NetTimeMicros), 0 if the server didn't tell us
+	uint32_t SampleTime;
+
+	// when we got the newest state, in game time seconds
+	double ReceiveTime;
+
+	// how the car was moving at the newest state, in units a second
+	Vector3 Velocity;
+
+	// how fast the direction of travel turns around the up axis, in radians a second
+	float TurnRate;
+
+	// how fast the yaw turns, in yaw units a second
+	float YawRate;
+
+	// where the old prediction was when the newest state arrived, relative to the new prediction, faded out over DEAD_RECKONING_BLEND_TIME
+	Vector3 Correction;
+}DeadReckoning;
+
+/// <summary>
+/// Forget everything about a car, used when a player joins
+/// </summary>
+void DeadReckoningReset(DeadReckoning* motion);
+
+/// <summary>
+/// Add a new state for a car, states that we already have are ignored
+/// </summary>
+/// <param name="motion">The car</param>
+/// <param name="position">Where the car was</param>
+/// <param name="yaw">Which way it was facing</param>
+/// <param name="speed">How fast the game says it was going</param>
+/// <param name="sampleTime">When the owner sent it, 0 if unknown</param>
+/// <param name="now">The game time in seconds</param>
+void DeadReckoningAddState(DeadReckoning* motion, Vector3 position, float yaw, float speed, uint32_t sampleTime, double now);
+
+/// <summary>
+/// Predict where a car is now
+/// </summary>
+/// <param name="motion">The car</param>
+/// <param name="now">The game time in seconds</param>
+/// <param name="position">Filled in with where the car should be shown</param>
+/// <param name="yaw">Filled in with which way the car should be facing</param>
+void DeadReckoningPredict(const DeadReckoning* motion, double now, Vector3* position, float* yaw);
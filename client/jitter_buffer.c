@@ -0,0 +1,129 @@
+// a jitter buffer for remote cars
+
+#include "jitter_buffer.h"
+#include "client_math.h"
+
+#include <math.h>
+#include <string.h>
+
+static const BufferedState* GetState(const JitterBuffer* buffer, uint32_t age)
+{
+	return &buffer->States[(buffer->Newest - age) & (JITTER_BUFFER_SIZE - 1)];
+}
+
+// a state part of the way from one to another, the yaw is in radians so it turns the short way
+static void LerpState(const BufferedState* from, const BufferedState* to, float amount, BufferedState* state)
+{
+	state->Position = Vector3Lerp(from->Position, to->Position, amount);
+	state->Pitch = from->Pitch + (to->Pitch - from->Pitch) * amount;
+	state->Yaw = from->Yaw + WrapAngle(to->Yaw - from->Yaw) * amount;
+	state->Speed = from->Speed + (to->Speed - from->Speed) * amount;
+}
+
+void JitterBufferReset(JitterBuffer* buffer)
+{
+	memset(buffer, 0, sizeof(JitterBuffer));
+	buffer->Delay = JITTER_START_DELAY;
+}
+
+void JitterBufferAdd(JitterBuffer* buffer, const BufferedState* state, uint32_t sampleTime, double now)
+{
+	// without the owner's clock all we have is when it arrived, the delay then covers the jitter of the whole path
+	double time = now;
+	if (sampleTime != 0)
+	{
+		if (buffer->Count == 0)
+			time = sampleTime / 1000000.0;
+		else
+			time = GetState(buffer, 0)->Time + (int32_t)(sampleTime - buffer->LastSampleTime) / 1000000.0;
+	}
+
+	// the server repeats a car's state in every snapshot until the owner sends a new one
+	if (buffer->Count > 0 && time <= GetState(buffer, 0)->Time)
+		return;
+
+	// the fastest a state has ever reached us is as close as we can get to the difference between the clocks
+	double transit = now - time;
+	if (buffer->Count == 0 || transit < buffer->Offset)
+		buffer->Offset = transit;
+
+	// how far past the newest state the owner's clock got before this one showed up, the delay has to cover that
+	if (buffer->Count > 0)
+	{
+		double waited = (now - buffer->Offset) - GetState(buffer, 0)->Time;
+		if (waited > buffer->Peak)
+			buffer->Peak = waited;
+	}
+
+	buffer->Newest = (buffer->Newest + 1) & (JITTER_BUFFER_SIZE - 1);
+	if (buffer->Count < JITTER_BUFFER_SIZE)
+		buffer->Count++;
+
+	BufferedState* stored = &buffer->States[buffer->Newest];
+	*stored = *state;
+	stored->Time = time;
+	buffer->LastSampleTime = sampleTime;
+}
+
+bool JitterBufferSample(JitterBuffer* buffer, double now, BufferedState* state)
+{
+	if (buffer->Count == 0)
+		return false;
+
+	// move the delay toward the longest recent wait, slowly enough that the car never visibly speeds up or slows down
+	double elapsed = buffer->LastSample > 0 ? now - buffer->LastSample : 0;
+	buffer->LastSample = now;
+
+	// let the clock difference creep up, a lower transit soon pulls it back, so we follow the two clocks drifting apart
+	buffer->Offset += JITTER_CLOCK_DRIFT * elapsed;
+
+	buffer->Peak -= JITTER_PEAK_DECAY * elapsed;
+	if (buffer->Peak < 0)
+		buffer->Peak = 0;
+
+	double target = buffer->Peak + JITTER_DELAY_MARGIN;
+	if (target < JITTER_MIN_DELAY)
+		target = JITTER_MIN_DELAY;
+	if (target > JITTER_MAX_DELAY)
+		target = JITTER_MAX_DELAY;
+
+	// the further off the delay is the faster it moves, so small wobbles in the target don't turn into the car surging back and forth
+	double rate = (target - buffer->Delay) * JITTER_ADAPT_GAIN;
+	rate = fmax(-JITTER_SHRINK_RATE, fmin(JITTER_GROW_RATE, rate));
+	buffer->Delay += rate * elapsed;
+
+	// the time on the owner's clock that we are showing
+	double playback = now - buffer->Offset - buffer->Delay;
+
+	// past the newest state, the next one is late, keep going the way the car was going
+	const BufferedState* newest = GetState(buffer, 0);
+	if (playback >= newest->Time)
+	{
+		*state = *newest;
+		if (buffer->Count < 2)
+			return true;
+
+		buffer->Underruns++;
+
+		const BufferedState* previous = GetState(buffer, 1);
+		double ahead = fmin(playback - newest->Time, JITTER_MAX_EXTRAPOLATION);
+		LerpState(previous, newest, (float)(1 + ahead / (newest->Time - previous->Time)), state);
+		return true;
+	}
+
+	// find the two states either side of the playback time
+	for (uint32_t age = 1; age < buffer->Count; age++)
+	{
+		const BufferedState* from = GetState(buffer, age);
+		if (from->Time > playback)
+			continue;
+
+		const BufferedState* to = GetState(buffer, age - 1);
+		LerpState(from, to, (float)((playback - from->Time) / (to->Time - from->Time)), state);
+		return true;
+	}
+
+	// older than anything we still have
+	*state = *GetState(buffer, buffer->Count - 1);
+	return true;
+}
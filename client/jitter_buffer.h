@@ -0,0 +1,100 @@
+// a jitter buffer for remote cars
+// states arrive at uneven times, so instead of showing each one the moment it arrives, remote cars are shown a little in the past,
+// in between the two states either side of that time. The delay adapts to how uneven the link is.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "raymath.h"
+
+// how many states are kept for every car, must be a power of two
+#define JITTER_BUFFER_SIZE 32
+
+// the delay a car starts with, and the range it adapts in, in seconds
+#define JITTER_START_DELAY 0.1
+#define JITTER_MIN_DELAY 0.02
+#define JITTER_MAX_DELAY 0.3
+
+// added on top of the longest wait we have seen recently, so the newest state is not always only just in time
+#define JITTER_DELAY_MARGIN 0.01
+
+// how fast the longest recent wait is forgotten, in seconds a second, so the delay shrinks again on a clean link
+#define JITTER_PEAK_DECAY 0.02
+
+// how fast the difference between the owner's clock and ours is allowed to drift, in seconds a second
+#define JITTER_CLOCK_DRIFT 0.0005
+
+// how fast the delay can change, as a fraction of real time. Growing plays the car back 20% slower for a moment,
+// shrinking 5% faster, so neither is visible
+#define JITTER_GROW_RATE 0.2
+#define JITTER_SHRINK_RATE 0.05
+
+// how fast the delay closes the gap to where it should be, in fractions of the gap a second
+#define JITTER_ADAPT_GAIN 2.0
+
+// if the buffer runs dry, keep the car going on its last velocity for at most this long
+#define JITTER_MAX_EXTRAPOLATION 0.1
+
+// one state of a car
+typedef struct
+{
+	// when the owner sent it, on their clock, in seconds
+	double Time;
+
+	Vector3 Position;
+	float Pitch;
+	float Yaw;
+	float Speed;
+}BufferedState;
+
+// the recent states of one car and how far behind them it is played back
+typedef struct
+{
+	BufferedState States[JITTER_BUFFER_SIZE];
+	uint32_t Count;
+
+	// the index of the newest state
+	uint32_t Newest;
+
+	// the SampleTime of the newest state, to turn the next one into seconds without the wrap
+	uint32_t LastSampleTime;
+
+	// the shortest time a state has taken to reach us, it turns the owner's clock into ours
+	double Offset;
+
+	// the longest we have recently had to wait past the newest state for the next one, slowly forgotten
+	double Peak;
+
+	// how far behind the owner's clock the car is shown
+	double Delay;
+
+	// the last time the car was shown, to know how much to adapt by
+	double LastSample;
+
+	// how many times the car was shown past the newest state
+	uint32_t Underruns;
+}JitterBuffer;
+
+/// <summary>
+/// Forget every state of a car, used when a player joins
+/// </summary>
+void JitterBufferReset(JitterBuffer* buffer);
+
+/// <summary>
+/// Add a new state for a car, states that are not newer than the newest one are ignored
+/// </summary>
+/// <param name="buffer">The car</param>
+/// <param name="state">The state, Time is ignored</param>
+/// <param name="sampleTime">When the owner sent it (their NetTimeMicros), 0 if unknown</param>
+/// <param name="now">When the state arrived, in seconds</param>
+void JitterBufferAdd(JitterBuffer* buffer, const BufferedState* state, uint32_t sampleTime, double now);
+
+/// <summary>
+/// Work out where a car should be shown now, and adapt the delay
+/// </summary>
+/// <param name="buffer">The car</param>
+/// <param name="now">The time in seconds, on the same clock as JitterBufferAdd</param>
+/// <param name="state">Filled in with the state to show</param>
+/// <returns>False if there are no states yet</returns>
+bool JitterBufferSample(JitterBuffer* buffer, double now, BufferedState* state);
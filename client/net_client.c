@@ -32,14 +32,104 @@
 
 
 #include "net_client.h"
+#include "dead_reckoning.h"
+#include "jitter_buffer.h"
 
 #define ENET_IMPLEMENTATION
 #include "net_common.h"
+#include "net_snapshot.h"
+#include "net_messages.h"
+#include "net_batch.h"
+#include "net_spsc.h"
+#include "net_thread.h"
 
+#include <stdatomic.h>
+
+
+// enet is serviced on its own thread, so packets are read and answered the moment they arrive instead of once per drawn frame
+// the network thread and the game thread never share data, they only pass messages to each other through two lock free rings
+
+// how many messages can wait for the game thread, a full world snapshot is one message per car
+#define TO_GAME_CAPACITY 1024
+
+// how many messages can wait for the network thread, the game sends one local state per frame
+#define TO_NET_CAPACITY 64
+
+// the longest the network thread waits on the socket before it checks for messages from the game, in milliseconds
+#define NET_MAX_WAIT 5
+
+// how long to wait between input updates in microseconds (20 update ticks a second)
+#define INPUT_SEND_INTERVAL (1000000 / 20)
+
+// what a message between the threads is about
+typedef enum
+{
+	// network -> game, PlayerId is the id the server gave us
+	MessageAccept,
+
+	// network -> game, PlayerId joined or left the room
+	MessageAddPlayer,
+	MessageRemovePlayer,
+
+	// network -> game, the newest known state of PlayerId
+	MessageCarState,
+
+	// network -> game, the race lifecycle
+	MessageMasterReady,
+	MessageRaceStart,
+
+	// network -> game, the connection is gone and the network thread has stopped
+	MessageDisconnected,
+
+	// game -> network, the newest state of the local car
+	MessageLocalState,
+
+	// game -> network, the local player is ready to race
+	MessageReady,
+}ClientMessageType;
+
+// one message between the threads
+typedef struct
+{
+	uint8_t Type;
+	uint8_t PlayerId;
+	CarState Car;
+
+	// when the network thread received the packet the message came from, its NetTimeMicros
+	uint64_t ReceiveTime;
+}ClientMessage;
+
+// game thread data
 
 // the player id of this client
 int LocalPlayerId = -1;
 
+// true from Connect until the network thread tells us the connection is gone
+bool NetActive = false;
+
+double LastNow = 0;
+
+int GameState = 0;
+
+// how remote cars are shown between states
+SmoothingMode Smoothing = SmoothingInterpolate;
+
+bool IsReady = false;
+
+// messages from the network thread to the game thread
+SpscRing ToGame = { 0 };
+
+// messages from the game thread to the network thread
+SpscRing ToNet = { 0 };
+
+// the thread that services enet
+NetThread NetworkThread = { 0 };
+
+// cleared to tell the network thread to stop, set and cleared by the game thread and read by the network thread
+atomic_bool NetRunning = false;
+
+// network thread data, the game thread only touches these while the network thread is not running
+
 // the enet address we are connected to
 ENetAddress address = { 0 };
 
@@ -49,19 +139,18 @@ ENetPeer* server = { 0 };
 // the client peer we are using
 ENetHost* client = { 0 };
 
-// time data for the network tick so that we don't spam the server with one update every drawing frame
+// the player id the server gave us, as the network thread knows it
+int NetPlayerId = -1;
 
-// how long in seconds since the last time we sent an update
-double LastInputSend = -100;
+// the newest state of the local car the game thread gave us
+CarState LocalState = { 0 };
+bool HasLocalState = false;
 
-// how long to wait between updates (20 update ticks a second)
-double InputUpdateInterval = 1.0f / 20.0f;
+// the tick number of the newest world snapshot we have received
+uint32_t LastWorldTick = 0;
 
-double LastNow = 0;
-
-int GameState = 0;
-
-bool IsReady = FALSE;
+// the world snapshots we received recently, the server sends us changes against one of these
+SnapshotHistory WorldHistory = { 0 };
 
 //
 // Data about players
@@ -97,251 +186,535 @@ typedef struct
 	//where we think this item is right now based on the movement vector
 	Vector3 ExtrapolatedPosition;
 
+	// how the car is moving, worked out from the states the server sent us
+	DeadReckoning Motion;
+
+	// the recent states of the car, for interpolation
+	JitterBuffer Buffer;
+
 	uint32_t Base;
 
 }RemotePlayer;
 
+// the game memory we read once a frame, one call per block instead of one per field
+// reading a whole block also means every field comes from the same emulator frame
+uint8_t SystemBlock[gSystemBlockSize] = { 0 };
+uint8_t StateBlock[gStateBlockSize] = { 0 };
+uint8_t LocalCarBlock[CAR_STRIDE] = { 0 };
+
+// true if UpdateLocalPlayer already read the global blocks this frame
+bool GameBlocksRead = false;
+
 // The list of all possible players
 // this is the local simulation that represents the current game state
 // it includes the current local player and the last known data from all remote players
 // the client checks this every frame to see where everyone is on the field
 RemotePlayer Players[MAX_PLAYERS] = { 0 };
 
-// Connect to a server
-void Connect(const char* serverAddress)
+// Send a message to the game thread
+// lifecycle messages must not be lost, so they wait for room, car states are replaced by the next snapshot anyway so they are dropped
+void PushToGame(const ClientMessage* message)
 {
-	// startup the network library
-	enet_initialize();
-
-	// create a client that we will use to connect to the server
-	client = enet_host_create(NULL, 1, 1, 0, 0);
+	if (message->Type == MessageCarState)
+	{
+		SpscPush(&ToGame, message);
+		return;
+	}
 
-	// set the address and port we will connect to
-	enet_address_set_host(&address, serverAddress);
-	address.port = 4545;
+	while (!SpscPush(&ToGame, message) && atomic_load_explicit(&NetRunning, memory_order_acquire))
+		SleepThread(1);
+}
 
-	// start the connection process. Will be finished as part of our update
-	server = enet_host_connect(client, &address, 1, 0);
+// Send a message with no car data to the game thread
+void PushEvent(ClientMessageType type, int playerId)
+{
+	ClientMessage message = { 0 };
+	message.Type = (uint8_t)type;
+	message.PlayerId = (uint8_t)playerId;
+	PushToGame(&message);
 }
 
 // Utility functions to read data out of a packet
 
-/// <summary>
-/// Read a player position from the network packet
-/// player positions are sent as two signed shorts and converted into floats for display
-/// since this sample does everything in pixels, this is fine, but a more robust game would want to send floats
-/// </summary>
-/// <param name="packet"></param>
-/// <param name="offset"></param>
-/// <returns>A raylib Vector with the position in the data</returns>
-Vector3 ReadPosition(ENetPacket* packet, size_t* offset)
+// functions to handle the commands that the server will send to the client
+// these run on the network thread, they read the data out of the packet and pass it on to the game thread
+
+// The server accepted us and told us who we are
+void HandleAcceptPlayer(PacketReader* reader)
 {
-	Vector3 pos = { 0 };
-	pos.x = ReadFloat(packet, offset);
-	pos.y = ReadFloat(packet, offset);
-	pos.z = ReadFloat(packet, offset);
+	// See who the server says we are
+	AcceptPlayerMessage message;
+	if (!PacketReadAcceptPlayer(reader, &message))
+		return;
 
-	return pos;
-}
+	// Make sure that it makes sense
+	int playerId = message.PlayerId;
+	if (playerId >= MAX_PLAYERS)
+		return;
 
-// functions to handle the commands that the server will send to the client
-// these take the data from enet and read out various bits of data from it to do actions based on the command that was sent
+	NetPlayerId = playerId;
+
+	// a new connection means the server may have restarted its tick count
+	LastWorldTick = 0;
+	memset(&WorldHistory, 0, sizeof(WorldHistory));
+
+	PushEvent(MessageAccept, playerId);
+}
 
 // A new remote player was added to our local simulation
-void HandleAddPlayer(ENetPacket* packet, size_t* offset)
+void HandleAddPlayer(PacketReader* reader)
 {
 	// find out who the server is talking about
-	int remotePlayer = ReadByte(packet, offset);
-	if (remotePlayer >= MAX_PLAYERS || remotePlayer == LocalPlayerId)
+	AddPlayerMessage message;
+	if (!PacketReadAddPlayer(reader, &message))
 		return;
 
-	Players[remotePlayer].Base = pBase[1];
-
-	// set them as active and update the location
-	Players[remotePlayer].Active = true;
-	//Players[remotePlayer].Position = ReadPosition(packet, offset);
-	//Players[remotePlayer].Pitch = ReadFloat(packet, offset);
-	//Players[remotePlayer].Yaw = ReadFloat(packet, offset);
-	//Players[remotePlayer].Speed = ReadFloat(packet, offset);
-	//Players[remotePlayer].BrakeLight = ReadByte(packet, offset);
-	//Players[remotePlayer].Car = ReadByte(packet, offset);
-	//Players[remotePlayer].CarNumber = ReadByte(packet, offset);
-
-	Players[remotePlayer].UpdateTime = LastNow;
+	int remotePlayer = message.PlayerId;
+	if (remotePlayer >= MAX_PLAYERS || remotePlayer == NetPlayerId)
+		return;
 
 	// In a more robust game, this message would have more info about the new player, such as what sprite or model to use, player name, or other data a client would need
 	// this is where static data about the player would be sent, and any initial state needed to setup the local simulation
+	PushEvent(MessageAddPlayer, remotePlayer);
 }
 
 // A remote player has left the game and needs to be removed from the local simulation
-void HandleRemovePlayer(ENetPacket* packet, size_t* offset)
+void HandleRemovePlayer(PacketReader* reader)
 {
 	// find out who the server is talking about
-	int remotePlayer = ReadByte(packet, offset);
-	if (remotePlayer >= MAX_PLAYERS || remotePlayer == LocalPlayerId)
+	RemovePlayerMessage message;
+	if (!PacketReadRemovePlayer(reader, &message))
+		return;
+
+	int remotePlayer = message.PlayerId;
+	if (remotePlayer >= MAX_PLAYERS || remotePlayer == NetPlayerId)
 		return;
 
 	// remove the player from the simulation. No other data is needed except the player id
-	Players[remotePlayer].Active = false;
+	PushEvent(MessageRemovePlayer, remotePlayer);
 }
 
-// The server has a new position for a player in our local simulation
-void HandleUpdatePlayer(ENetPacket* packet, size_t* offset)
+// The server sent us the state of every player for one server tick, as changes against a snapshot we already have
+void HandleUpdateWorld(PacketReader* reader)
 {
-	// find out who the server is talking about
-	int remotePlayer = ReadByte(packet, offset);
-	if (remotePlayer >= MAX_PLAYERS || remotePlayer == LocalPlayerId || !Players[remotePlayer].Active)
+	WorldSnapshot world;
+	if (!ReadWorldSnapshot(reader, &WorldHistory, &world))
+		return;
+
+	// snapshots are numbered, never let an older one overwrite a newer one
+	if (world.Tick <= LastWorldTick)
 		return;
 
-	// update the last known position and movement
-	Players[remotePlayer].Position = ReadPosition(packet, offset);
-    Players[remotePlayer].Pitch = ReadFloat(packet, offset);
-	Players[remotePlayer].Yaw = ReadFloat(packet, offset);
-	Players[remotePlayer].Speed = ReadFloat(packet, offset);
-	Players[remotePlayer].BrakeLight = ReadByte(packet, offset);
-	Players[remotePlayer].Car = ReadByte(packet, offset);
-	Players[remotePlayer].CarNumber = ReadByte(packet, offset);
-
-	Players[remotePlayer].UpdateTime = LastNow;
-	// in a more robust game this message would have a tick ID for what time this information was valid, and extra info about
-	// what the input state was so the local simulation could do prediction and smooth out the motion
+	// every snapshot goes in the history, since later ones can be encoded against it
+	LastWorldTick = world.Tick;
+	*StoreSnapshot(&WorldHistory, world.Tick) = world;
+
+	// tell the server we have this one so it can send the next ones as changes against it
+	// if the ack is lost the server just keeps using an older baseline, so it doesn't need to be reliable
+	AckWorldMessage ack = { 0 };
+	ack.Tick = world.Tick;
+	ENetPacket* ackPacket = CreateAckWorldPacket(&ack, 0);
+	if (ackPacket != NULL)
+		enet_peer_send(server, CHANNEL_STATE, ackPacket);
+
+	// hand every remote car to the game thread, it applies them in order so it always ends up on the newest
+	uint64_t receiveTime = NetTimeMicros();
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (!(world.Present & (1 << i)) || i == NetPlayerId)
+			continue;
+
+		ClientMessage message = { 0 };
+		message.Type = MessageCarState;
+		message.PlayerId = (uint8_t)i;
+		message.Car = world.Cars[i];
+		message.ReceiveTime = receiveTime;
+		PushToGame(&message);
+	}
 }
 
-// process one frame of updates
-void Update(double now, float deltaT)
+// Handle one message from the server, the reader starts at its command
+void HandleMessage(PacketReader* reader)
 {
-	LastNow = now;
-	// if we are not connected to anything yet, we can't do anything, so bail out early
-	if (server == NULL)
+	// see what the server wants us to do
+	NetworkCommands command = (NetworkCommands)reader->Data[0];
+
+	// if the server has not accepted us yet, we are limited in what messages we can receive
+	if (NetPlayerId == -1)
+	{
+		if (command == AcceptPlayer)    // this is the only thing we can do in this state, so ignore anything else
+			HandleAcceptPlayer(reader);
+		return;
+	}
+
+	// we have been accepted, so process play messages from the server
+	switch (command)
+	{
+		case AddPlayer:
+			HandleAddPlayer(reader);
+			break;
+
+		case RemovePlayer:
+			HandleRemovePlayer(reader);
+			break;
+
+		case UpdateWorld:
+			HandleUpdateWorld(reader);
+			break;
+
+		case MasterIsReady:
+			PushEvent(MessageMasterReady, NetPlayerId);
+			break;
+
+		case RaceStart:
+			PushEvent(MessageRaceStart, NetPlayerId);
+			break;
+	}
+}
+
+// Handle one packet from the server, it is either one message or a batch of them (net_batch.h)
+void HandlePacket(ENetPacket* packet)
+{
+	// we know that all valid packets have a size >= 1, so if we get this, something is bad and we ignore it.
+	if (packet->dataLength < 1)
 		return;
 
-	// Check if we have been accepted, and if so, check the clock to see if it is time for us to send the updated position for the local player
-	// we do this so that we don't spam the server with updates 60 times a second and waste bandwidth
-	// in a real game we'd send our normalized movement vector or input keys along with what the current tick index was
-	// this way the server can know how long it's been since the last update and can do interpolation to know were we are between updates.
-	if (LocalPlayerId >= 0 && now - LastInputSend > InputUpdateInterval)
+	// the reader keeps track of what data we have read so far, every handler reads its whole message from the start
+	PacketReader reader;
+	BeginRead(&reader, packet);
+
+	// the messages in a batch are handled in the order the server queued them, the accept always comes first
+	PacketReader message;
+	while (BatchNext(&reader, &message))
+		HandleMessage(&message);
+}
+
+// Send the newest local car state to the server
+void SendLocalState()
+{
+	// Pack the data we want to send straight into a packet provided by enet
+	// the packed car (net_car_codec.h) and the time we sent it, see UpdateInput in net_messages.h
+	// positions are unreliable, a newer one is never more than a tick away
+	UpdateInputMessage message = { 0 };
+	message.Car = LocalState;
+	message.SampleTime = (uint32_t)NetTimeMicros();
+
+	// send the packet to the server
+	// NOTE enet_host_service will handle releasing send packets when the network system has finally sent them,
+	// you don't have to destroy them
+	ENetPacket* packet = CreateUpdateInputPacket(&message, 0);
+	if (packet != NULL)
+		enet_peer_send(server, CHANNEL_STATE, packet);
+}
+
+// Tell the server the local player is ready
+void SendReady()
+{
+	// Pack the command straight into a packet provided by enet, the command is all there is to it
+	PlayerIsReadyMessage message = { 0 };
+
+	// send the packet to the server
+	ENetPacket* packet = CreatePlayerIsReadyPacket(&message, ENET_PACKET_FLAG_RELIABLE);
+	if (packet != NULL)
+		enet_peer_send(server, CHANNEL_CONTROL, packet);
+}
+
+// Take everything the game thread sent us, only the newest local state is kept
+void HandleGameMessages()
+{
+	ClientMessage message;
+	while (SpscPop(&ToNet, &message))
 	{
-					// Pack up a buffer with the data we want to send
-					uint8_t buffer[40] = { 0 }; // 9 bytes for a 1 byte command number and two bytes for each X and Y value
-					buffer[0] = (uint8_t)UpdateInput;   // this tells the server what kind of data to expect in this packet
-					*(float*)(buffer + 1) = (float)Players[LocalPlayerId].Position.x;
-					*(float*)(buffer + 5) = (float)Players[LocalPlayerId].Position.y;
-					*(float*)(buffer + 9) = (float)Players[LocalPlayerId].Position.z;
-					*(float*)(buffer + 13) = (float)Players[LocalPlayerId].Pitch;
-					*(float*)(buffer + 17) = (float)Players[LocalPlayerId].Yaw;
-					*(float*)(buffer + 21) = (float)Players[LocalPlayerId].Speed;
-					buffer[25] = (uint8_t)Players[LocalPlayerId].BrakeLight;
-					buffer[26] = (uint8_t)Players[LocalPlayerId].Car;
-					buffer[27] = (uint8_t)Players[LocalPlayerId].CarNumber;
-
-					// copy this data into a packet provided by enet (TODO : add pack functions that write directly to the packet to avoid the copy)
-					ENetPacket* packet = enet_packet_create(buffer, 40, ENET_PACKET_FLAG_RELIABLE);
-
-					// send the packet to the server
-					enet_peer_send(server, 0, packet);
-
-					// NOTE enet_host_service will handle releasing send packets when the network system has finally sent them,
-					// you don't have to destroy them
-
-					// mark that now was the last time we sent an update
-					LastInputSend = now;
+		switch (message.Type)
+		{
+			case MessageLocalState:
+				LocalState = message.Car;
+				HasLocalState = true;
+				break;
 
+			case MessageReady:
+				SendReady();
+				break;
+		}
 	}
+}
+
+// The network thread, services enet until the connection is lost or we are told to stop
+void NetThreadMain(void* arg)
+{
+	(void)arg;
 
-	// read one event from enet and process it
-	ENetEvent Event = { 0 };
+	// Force the first update to go out as soon as we have been accepted
+	uint64_t lastInputSend = 0;
 
-	// Check to see if we even have any events to do. Since this is a a client, we don't set a timeout so that the client can keep going if there are no events
-	if (enet_host_service(client, &Event, 0) > 0)
+	while (atomic_load_explicit(&NetRunning, memory_order_acquire))
 	{
-		// see what kind of event it is
-		switch (Event.type)
+		HandleGameMessages();
+
+		// Check if we have been accepted, and if so, check the clock to see if it is time for us to send the updated position for the local player
+		// we do this so that we don't spam the server with updates and waste bandwidth
+		uint64_t now = NetTimeMicros();
+		if (NetPlayerId >= 0 && HasLocalState && now - lastInputSend >= INPUT_SEND_INTERVAL)
+		{
+			SendLocalState();
+
+			// mark that now was the last time we sent an update
+			lastInputSend = now;
+		}
+
+		// sleep in enet until something arrives or the next update is due, but never so long that the game's messages have to wait around
+		uint32_t timeout = NET_MAX_WAIT;
+		if (NetPlayerId >= 0 && HasLocalState)
+		{
+			uint64_t untilSend = (lastInputSend + INPUT_SEND_INTERVAL - now) / 1000;
+			if (untilSend < timeout)
+				timeout = (uint32_t)untilSend;
+		}
+
+		// service receives everything that has arrived, check_events then hands out the rest of it without touching the network again
+		ENetEvent event = { 0 };
+		int eventStatus = enet_host_service(client, &event, timeout);
+		while (eventStatus > 0)
 		{
-			// the server sent us some data, we should process it
-			case ENET_EVENT_TYPE_RECEIVE:
+			// see what kind of event it is
+			switch (event.type)
 			{
-				// we know that all valid packets have a size >= 1, so if we get this, something is bad and we ignore it.
-				if (Event.packet->dataLength < 1)
+				// the server sent us some data, we should process it
+				case ENET_EVENT_TYPE_RECEIVE:
+					HandlePacket(event.packet);
+
+					// tell enet that it can recycle the packet data
+					enet_packet_destroy(event.packet);
 					break;
 
-				// keep an offset of what data we have read so far
-				size_t offset = 0;
+				// we were disconnected, we have a sad
+				case ENET_EVENT_TYPE_DISCONNECT:
+				case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
+					server = NULL;
+					NetPlayerId = -1;
+					PushEvent(MessageDisconnected, 0);
+					return;
+			}
 
-				// read off the command that the server wants us to do
-				NetworkCommands command = (NetworkCommands)ReadByte(Event.packet, &offset);
+			eventStatus = enet_host_check_events(client, &event);
+		}
+	}
+}
 
-				// if the server has not accepted us yet, we are limited in what packets we can receive
-				if (LocalPlayerId == -1)
-				{
-					if (command == AcceptPlayer)    // this is the only thing we can do in this state, so ignore anything else
-					{
-						// See who the server says we are
-						LocalPlayerId = ReadByte(Event.packet, &offset);
-
-						// Make sure that it makes sense
-						if (LocalPlayerId < 0 || LocalPlayerId > MAX_PLAYERS)
-						{
-							LocalPlayerId = -1;
-							break;
-						}
-
-						// Force the next frame to do an update by pretending it's been a very long time since our last update
-						LastInputSend = -InputUpdateInterval;
-
-						// We are active
-						Players[LocalPlayerId].Active = true;
-
-						// LocalPlayerBase
-						Players[LocalPlayerId].Base = pBase[0];
-						// Set our player at some location on the field.
-						// optimally we would do a much more robust connection negotiation where we tell the server what our name is, what we look like
-						// and then the server tells us where we are
-						// But for this simple test, everyone starts at the same place on the field
-						Players[LocalPlayerId].Position = (Vector3){ 100, 100, 100 };
-					}
-				}
-				else // we have been accepted, so process play messages from the server
-				{
-					// see what the server wants us to do
-					switch (command)
-					{
-						case AddPlayer:
-							HandleAddPlayer(Event.packet, &offset);
-							break;
-
-						case RemovePlayer:
-							HandleRemovePlayer(Event.packet, &offset);
-							break;
-
-						case UpdatePlayer:
-							HandleUpdatePlayer(Event.packet, &offset);
-							break;
-
-						case MasterIsReady:
-							GameState = 1;
-							break;
-
-						case RaceStart:
-							GameState = 2;
-							break;
-
-					}
-				}
-				// tell enet that it can recycle the packet data
-				enet_packet_destroy(Event.packet);
+// Stop the network thread and close the connection, if there is one
+void StopNetwork()
+{
+	if (client == NULL)
+		return;
+
+	atomic_store_explicit(&NetRunning, false, memory_order_release);
+	JoinThread(&NetworkThread);
+
+	// the network thread is gone, so we own its data again
+	// close our connection to the server
+	if (server != NULL)
+		enet_peer_disconnect(server, 0);
+
+	// close our client
+	if (client != NULL)
+		enet_host_destroy(client);
+
+	client = NULL;
+	server = NULL;
+
+	// clean up enet
+	enet_deinitialize();
+
+	SpscFree(&ToGame);
+	SpscFree(&ToNet);
+	NetActive = false;
+}
+
+// Connect to a server
+void Connect(const char* serverAddress)
+{
+	// a reconnect, let the old thread go first
+	StopNetwork();
+
+	// startup the network library
+	enet_initialize();
+
+	// create a client that we will use to connect to the server
+	client = enet_host_create(NULL, 1, CHANNEL_COUNT, 0, 0);
+	if (client == NULL)
+	{
+		enet_deinitialize();
+		return;
+	}
+
+	// set the address and port we will connect to
+	enet_address_set_host(&address, serverAddress);
+	address.port = 4545;
+
+	// start the connection process. Will be finished on the network thread
+	// ask for the time every car state was sent, so dead reckoning can work out speeds without the network jitter in them
+	server = enet_host_connect(client, &address, CHANNEL_COUNT, ROOM_SIZE_DEFAULT | CONNECT_WANTS_TIMING);
+
+	NetPlayerId = -1;
+	HasLocalState = false;
+	LocalPlayerId = -1;
+
+	SpscInit(&ToGame, sizeof(ClientMessage), TO_GAME_CAPACITY);
+	SpscInit(&ToNet, sizeof(ClientMessage), TO_NET_CAPACITY);
+
+	atomic_store_explicit(&NetRunning, true, memory_order_release);
+	NetActive = StartThread(&NetworkThread, NetThreadMain, NULL);
+	if (!NetActive)
+		StopNetwork();
+}
+
+// Apply everything the network thread sent us since the last frame
+void HandleNetMessages()
+{
+	ClientMessage message;
+	while (SpscPop(&ToGame, &message))
+	{
+		int id = message.PlayerId;
+		switch (message.Type)
+		{
+			case MessageAccept:
+				LocalPlayerId = id;
+
+				// We are active
+				Players[LocalPlayerId].Active = true;
+
+				// LocalPlayerBase
+				Players[LocalPlayerId].Base = pBase[0];
+				// Set our player at some location on the field.
+				// optimally we would do a much more robust connection negotiation where we tell the server what our name is, what we look like
+				// and then the server tells us where we are
+				// But for this simple test, everyone starts at the same place on the field
+				Players[LocalPlayerId].Position = (Vector3){ 100, 100, 100 };
+				break;
+
+			case MessageAddPlayer:
+				if (LocalPlayerId < 0 || id == LocalPlayerId)
+					break;
+
+				Players[id].Base = pBase[1];
+
+				// set them as active
+				Players[id].Active = true;
+				Players[id].UpdateTime = LastNow;
+				DeadReckoningReset(&Players[id].Motion);
+				JitterBufferReset(&Players[id].Buffer);
+				break;
+
+			case MessageRemovePlayer:
+				if (id == LocalPlayerId)
+					break;
+
+				Players[id].Active = false;
+				break;
+
+			case MessageCarState:
+			{
+				if (id == LocalPlayerId || !Players[id].Active)
+					break;
+
+				const CarState* car = &message.Car;
+				Players[id].Position = (Vector3){ car->X, car->Y, car->Z };
+				Players[id].Pitch = car->Pitch;
+				Players[id].Yaw = car->Yaw;
+				Players[id].Speed = car->Speed;
+				Players[id].BrakeLight = car->BrakeLight;
+				Players[id].Car = car->Car;
+				Players[id].CarNumber = car->CarNumber;
+				Players[id].UpdateTime = LastNow;
+				DeadReckoningAddState(&Players[id].Motion, Players[id].Position, car->Yaw, car->Speed, car->SampleTime, LastNow);
+
+				BufferedState state = { 0 };
+				state.Position = Players[id].Position;
+				state.Pitch = car->Pitch;
+				state.Yaw = car->Yaw;
+				state.Speed = car->Speed;
+				JitterBufferAdd(&Players[id].Buffer, &state, car->SampleTime, message.ReceiveTime / 1000000.0);
 				break;
 			}
 
-			// we were disconnected, we have a sad
-			case ENET_EVENT_TYPE_DISCONNECT:
-				server = NULL;
+			case MessageMasterReady:
+				GameState = 1;
+				break;
+
+			case MessageRaceStart:
+				GameState = 2;
+				break;
+
+			case MessageDisconnected:
 				LocalPlayerId = -1;
+				NetActive = false;
 				break;
 		}
 	}
+}
+
+// Read the global blocks of game memory for this frame, and our car with them when we have one, in one gather
+void ReadGameBlocks(bool withLocalCar)
+{
+	MEM_ReadSpan spans[3] =
+	{
+		{ gSystemBlock, SystemBlock, gSystemBlockSize },
+		{ gStateBlock, StateBlock, gStateBlockSize },
+		{ 0, LocalCarBlock, CAR_STRIDE },
+	};
+
+	uint32_t count = 2;
+	if (withLocalCar)
+	{
+		spans[2].Addr = Players[LocalPlayerId].Base;
+		count = 3;
+	}
+
+	MEM_ReadSpans(spans, count);
+	GameBlocksRead = true;
+}
+
+// Take a field out of a block we read
+uint8_t BlockByte(const uint8_t* block, uint32_t offset)
+{
+	return block[offset];
+}
+
+// the block is in the RAM's byte order, one swap per field if that's not ours
+float BlockFloat(const uint8_t* block, uint32_t offset)
+{
+	uint32_t word;
+	memcpy(&word, block + offset, sizeof(word));
+	word = MEM_RamWord(word);
+
+	float value;
+	memcpy(&value, &word, sizeof(value));
+	return value;
+}
+
+// process one frame of updates
+void Update(double now, float deltaT)
+{
+	LastNow = now;
+
+	// the blocks UpdateLocalPlayer read this frame are still current, any older ones are not
+	bool blocksFresh = GameBlocksRead;
+	GameBlocksRead = false;
+
+	// if we are not connected to anything yet, we can't do anything, so bail out early
+	if (!NetActive)
+		return;
+
+	// the network thread has already read and acknowledged everything, we just pick up the results
+	HandleNetMessages();
+	if (!NetActive)
+		return;
 
 	/// Update Memory Stuff
-	uint8_t mode = MEM_ReadByte(gMainState);
+	if (!blocksFresh)
+		ReadGameBlocks(false);
+
+	uint8_t mode = BlockByte(StateBlock, gMainState - gStateBlock);
 	switch (mode)
 	{
 	    case msAtractMode: 
@@ -362,7 +735,7 @@ void Update(double now, float deltaT)
 		case msMainMenu:
 		{
 			PatchGame();
-			Sleep(200);
+			SleepThread(200);
 			MEM_WriteByte(gLink, 0x01);
 			MEM_WriteByte(gRPArrows, 0x3);
 			break;
@@ -388,56 +761,75 @@ void Update(double now, float deltaT)
 		case msRollingStart:
 		case msPreRacing:
 		case msRacing:
-			MEM_WriteInt(gMainTimer, 3420);
-			MEM_WriteByte(gRealPlayers, 0x2);
-			MEM_WriteByte(gCarCount, 0x1);
-			// update all the remote players with an interpolated position based on the last known good pos and how long it has been since an update
+			// every write here is staged and goes out in one batch at the end of the frame
+			// the game changes these, so they are pinned on every frame
+			MEM_BatchWriteIntAlways(gMainTimer, 3420);
+			MEM_BatchWriteByteAlways(gRealPlayers, 0x2);
+			MEM_BatchWriteByteAlways(gCarCount, 0x1);
+			// the jitter buffer runs on the same clock the network thread stamps packets with
+			double bufferNow = NetTimeMicros() / 1000000.0;
+
+			// update all the remote players with a predicted position based on the last known good pos, how they were moving and how long it has been since an update
 			for (int i = 0; i < MAX_PLAYERS; i++)
 			{
 				if (i == LocalPlayerId || !Players[i].Active)
 					continue;
 
-				double delta = LastNow - Players[i].UpdateTime;
-				Players[i].ExtrapolatedPosition = Vector3Add(Players[i].Position, Vector3Scale(Players[i].Direction, (float)delta));
-				MEM_WriteFloat((Players[i].Base + bXPos), Players[i].Position.x);
-				MEM_WriteFloat((Players[i].Base + bYPos), Players[i].Position.y);
-				MEM_WriteFloat((Players[i].Base + bZPos), Players[i].Position.z);
-				MEM_WriteFloat((Players[i].Base + bPitch), Players[i].Pitch);
-				MEM_WriteFloat((Players[i].Base + bYaw), Players[i].Yaw);
-				MEM_WriteFloat((Players[i].Base + bSpeed), Players[i].Speed);
-				MEM_WriteByte((Players[i].Base + bBrakeLight), Players[i].BrakeLight);
-				MEM_WriteByte((Players[i].Base + bCarType), CarValues[Players[i].Car]);
-				MEM_WriteByte((Players[i].Base + bCarNumber), Players[i].CarNumber);
-				MEM_WriteInt((Players[i].Base + bAIAccel), 0xFFFFFFFF);   //disables car AI
+				// interpolate in the jitter buffer if we can, or predict from the newest state
+				BufferedState shown = { 0 };
+				shown.Position = Players[i].Position;
+				shown.Pitch = Players[i].Pitch;
+				shown.Yaw = Players[i].Yaw;
+				shown.Speed = Players[i].Speed;
+
+				bool interpolated = Smoothing == SmoothingInterpolate && JitterBufferSample(&Players[i].Buffer, bufferNow, &shown);
+				if (!interpolated && Players[i].Motion.Valid)
+					DeadReckoningPredict(&Players[i].Motion, LastNow, &shown.Position, &shown.Yaw);
+
+				Players[i].Direction = Players[i].Motion.Velocity;
+				Players[i].ExtrapolatedPosition = shown.Position;
+
+				// the pose is skipped when it didn't change, the game may overwrite the rest so it is pinned every frame
+				MEM_BatchWriteFloat((Players[i].Base + bXPos), shown.Position.x);
+				MEM_BatchWriteFloat((Players[i].Base + bYPos), shown.Position.y);
+				MEM_BatchWriteFloat((Players[i].Base + bZPos), shown.Position.z);
+				MEM_BatchWriteFloat((Players[i].Base + bPitch), shown.Pitch);
+				MEM_BatchWriteFloat((Players[i].Base + bYaw), shown.Yaw);
+				MEM_BatchWriteFloat((Players[i].Base + bSpeed), shown.Speed);
+				MEM_BatchWriteByteAlways((Players[i].Base + bBrakeLight), Players[i].BrakeLight);
+				MEM_BatchWriteByteAlways((Players[i].Base + bCarType), CarValues[Players[i].Car]);
+				MEM_BatchWriteByteAlways((Players[i].Base + bCarNumber), Players[i].CarNumber);
+				MEM_BatchWriteIntAlways((Players[i].Base + bAIAccel), 0xFFFFFFFF);   //disables car AI
 			}
+
+			// write only what changed, and everything pinned, merged into as few calls as possible
+			MEM_BatchFlush();
 			break;
 	}
 
 
 }
 
-// force a disconnect by shutting down enet
+// force a disconnect by stopping the network thread and shutting down enet
 void Disconnect()
 {
-	// close our connection to the server
-	if (server != NULL)
-		enet_peer_disconnect(server, 0);
-
-	// close our client
-	if (client != NULL)
-		enet_host_destroy(client);
-
-	client = NULL;
-	server = NULL;
-
-	// clean up enet
-	enet_deinitialize();
+	StopNetwork();
 }
 
 // true if we are connected and have been accepted
 bool Connected()
 {
-	return server != NULL && LocalPlayerId >= 0;
+	return NetActive && LocalPlayerId >= 0;
+}
+
+void SetSmoothingMode(SmoothingMode mode)
+{
+	Smoothing = mode;
+}
+
+SmoothingMode GetSmoothingMode()
+{
+	return Smoothing;
 }
 
 int GetLocalPlayerId()
@@ -452,23 +844,40 @@ void UpdateLocalPlayer(float deltaT)
 	if (LocalPlayerId < 0)
 		return;
 
-    Players[LocalPlayerId].Car = MEM_ReadByte(gLocalPlayerCar);
-	Players[LocalPlayerId].CarNumber = MEM_ReadByte(gCarNumber);
+	// read the globals and the whole car in one go, then take the fields out of our copy
+	ReadGameBlocks(true);
+
+    Players[LocalPlayerId].Car = BlockByte(StateBlock, gLocalPlayerCar - gStateBlock);
+	Players[LocalPlayerId].CarNumber = BlockByte(SystemBlock, gCarNumber - gSystemBlock);
 
 	Vector3 tempPos = Players[LocalPlayerId].Position;
 
-	Players[LocalPlayerId].Position.x = MEM_ReadFloat(Players[LocalPlayerId].Base + bXPos);
-	Players[LocalPlayerId].Position.y = MEM_ReadFloat(Players[LocalPlayerId].Base + bYPos);
-	Players[LocalPlayerId].Position.z = MEM_ReadFloat(Players[LocalPlayerId].Base + bZPos);
+	Players[LocalPlayerId].Position.x = BlockFloat(LocalCarBlock, bXPos);
+	Players[LocalPlayerId].Position.y = BlockFloat(LocalCarBlock, bYPos);
+	Players[LocalPlayerId].Position.z = BlockFloat(LocalCarBlock, bZPos);
 
-	Players[LocalPlayerId].Speed = MEM_ReadFloat(Players[LocalPlayerId].Base + bSpeed);
-	Players[LocalPlayerId].BrakeLight = MEM_ReadByte(Players[LocalPlayerId].Base + bBrakeLight);
+	Players[LocalPlayerId].Speed = BlockFloat(LocalCarBlock, bSpeed);
+	Players[LocalPlayerId].BrakeLight = BlockByte(LocalCarBlock, bBrakeLight);
 
 	//Players[LocalPlayerId].Direction = Vector3Subtract(tempPos, Players[LocalPlayerId].Direction);
 
-	Players[LocalPlayerId].Pitch = MEM_ReadFloat(Players[LocalPlayerId].Base + bPitch);
-	//Players[LocalPlayerId].Roll = MEM_ReadFloat(Players[LocalPlayerId].Base);
-	Players[LocalPlayerId].Yaw = MEM_ReadFloat(Players[LocalPlayerId].Base + bYaw);
+	Players[LocalPlayerId].Pitch = BlockFloat(LocalCarBlock, bPitch);
+	//Players[LocalPlayerId].Roll = BlockFloat(LocalCarBlock, 0);
+	Players[LocalPlayerId].Yaw = BlockFloat(LocalCarBlock, bYaw);
+
+	// hand the state to the network thread, it sends the newest one it has 20 times a second
+	ClientMessage message = { 0 };
+	message.Type = MessageLocalState;
+	message.Car.X = Players[LocalPlayerId].Position.x;
+	message.Car.Y = Players[LocalPlayerId].Position.y;
+	message.Car.Z = Players[LocalPlayerId].Position.z;
+	message.Car.Pitch = Players[LocalPlayerId].Pitch;
+	message.Car.Yaw = Players[LocalPlayerId].Yaw;
+	message.Car.Speed = Players[LocalPlayerId].Speed;
+	message.Car.BrakeLight = Players[LocalPlayerId].BrakeLight;
+	message.Car.Car = Players[LocalPlayerId].Car;
+	message.Car.CarNumber = Players[LocalPlayerId].CarNumber;
+	SpscPush(&ToNet, &message);
 
 	//-----------------------------------------------------------------------------------------------------
 
@@ -523,14 +932,8 @@ bool GetPlayerPos(int id, Vector3* pos)
 
 void LocalPlayerIsReady()
 {
-	// Pack up a buffer with the data we want to send
-	IsReady = TRUE;
-	uint8_t buffer[1] = { 0 }; // 9 bytes for a 1 byte command number and two bytes for each X and Y value
-	buffer[0] = (uint8_t)PlayerIsReady;   // this tells the server what kind of data to expect in this packet
-
-	// copy this data into a packet provided by enet (TODO : add pack functions that write directly to the packet to avoid the copy)
-	ENetPacket* packet = enet_packet_create(buffer, 1, ENET_PACKET_FLAG_RELIABLE);
-
-	// send the packet to the server
-	enet_peer_send(server, 0, packet);
+	// the network thread sends it reliably, if its queue is full we try again next frame
+	ClientMessage message = { 0 };
+	message.Type = MessageReady;
+	IsReady = NetActive && SpscPush(&ToNet, &message);
 }
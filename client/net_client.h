@@ -57,6 +57,20 @@ void UpdateLocalPlayer(float deltaT);
 // get the id that the server assigned to us
 int GetLocalPlayerId();
 
+// how remote cars are shown between the states the server sends
+typedef enum
+{
+	// predict where the car is now from the newest state (dead reckoning)
+	SmoothingExtrapolate = 0,
+
+	// show the car a little in the past, in between two states it really was in (jitter buffer)
+	SmoothingInterpolate = 1,
+}SmoothingMode;
+
+// choose how remote cars are shown, so the two can be compared
+void SetSmoothingMode(SmoothingMode mode);
+SmoothingMode GetSmoothingMode();
+
 // get the position info for a player from the local simulation that has the latest network data in it
 // returns false if the player id is not valid
 
@@ -0,0 +1,433 @@
+/**********************************************************************************************
+*
+*   raylib_networking_smaple * a sample network game using raylib and enet
+*
+*   LICENSE: ZLIB
+*
+*   Copyright (c) 2023 Jeffery Myers
+*
+*   Permission is hereby granted, free of charge, to any person obtaining a copy
+*   of this software and associated documentation files (the "Software"), to deal
+*   in the Software without restriction, including without limitation the rights
+*   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*   copies of the Software, and to permit persons to whom the Software is
+*   furnished to do so, subject to the following conditions:
+*
+*   The above copyright notice and this permission notice shall be included in all
+*   copies or substantial portions of the Software.
+*
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*   SOFTWARE.
+*
+**********************************************************************************************/
+
+// a stand in for Supermodel running Scud Race
+// it lays out the Model 3 RAM the way scudplus.h describes it, and runs the game states at 57.5 frames a second,
+// attract -> main menu -> loading -> rolling start -> pre racing -> racing -> attract, with the local car driving laps of an oval.
+// the client can attach to it with the shm backend, or with the linux backend like it would to the real emulator,
+// so the whole client and server pipeline can be run and measured without the emulator or the game.
+
+#define ENET_IMPLEMENTATION
+#include "net_common.h"
+#include "net_thread.h"
+#include "net_byteorder.h"
+#include "memory.h"
+#include "scudplus.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+// Model 3 runs at 57.5 frames a second
+#define FRAME_PERIOD 17391
+
+// how long each state lasts in seconds, loading also waits for the client to unpause the game
+#define ATTRACT_TIME 3
+#define MENU_TIME 2
+#define LOADING_TIME 1
+#define ROLLING_START_TIME 2
+#define PRE_RACING_TIME 1
+#define DEFAULT_RACE_TIME 60
+
+// the race timer the game counts down, the client keeps setting it back to this
+#define RACE_TIMER_START 3420
+
+// how often the status line is printed, in frames
+#define STATUS_INTERVAL 58
+
+typedef struct
+{
+	// how many seconds to run for, 0 is forever
+	int Duration;
+
+	// how long a race lasts if the timer doesn't run out first
+	int RaceTime;
+
+	// which car the local player drives and its number
+	int Car;
+	int CarNumber;
+
+	// the name of the shared memory segment
+	const char* Name;
+
+	// keep the words in the RAM big endian, like the PowerPC does, instead of in our order like Supermodel
+	bool BigEndian;
+}FakeConfig;
+
+static FakeConfig Config;
+
+// the emulated RAM, the linux backend follows this pointer like it follows Supermodel's
+uint8_t* EmuRam = NULL;
+
+// how many frames the current state has run for
+static uint32_t StateFrames = 0;
+
+#if defined(_WIN32)
+static HANDLE Mapping = NULL;
+#endif
+
+static void RamWriteByte(uint32_t addr, uint8_t value)
+{
+	EmuRam[addr] = value;
+}
+
+static uint32_t RamWord(uint32_t word)
+{
+	return Config.BigEndian ? BigEndian32(word) : word;
+}
+
+static void RamWriteInt(uint32_t addr, uint32_t value)
+{
+	uint32_t word = RamWord(value);
+	memcpy(EmuRam + addr, &word, sizeof(word));
+}
+
+static void RamWriteFloat(uint32_t addr, float value)
+{
+	uint32_t word;
+	memcpy(&word, &value, sizeof(word));
+	RamWriteInt(addr, word);
+}
+
+static uint8_t RamReadByte(uint32_t addr)
+{
+	return EmuRam[addr];
+}
+
+static uint32_t RamReadInt(uint32_t addr)
+{
+	uint32_t word;
+	memcpy(&word, EmuRam + addr, sizeof(word));
+	return RamWord(word);
+}
+
+static float RamReadFloat(uint32_t addr)
+{
+	uint32_t word = RamReadInt(addr);
+	float value;
+	memcpy(&value, &word, sizeof(value));
+	return value;
+}
+
+// create the shared memory segment the RAM lives in
+static bool CreateRam(void)
+{
+#if defined(_WIN32)
+	Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, MEM_SHM_SIZE, Config.Name);
+	if (Mapping == NULL)
+		return false;
+
+	EmuRam = (uint8_t*)MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, MEM_SHM_SIZE);
+	if (EmuRam == NULL)
+		return false;
+
+	memset(EmuRam, 0, MEM_SHM_SIZE);
+#else
+	// start from a clean segment, not one left behind by an earlier run
+	shm_unlink(Config.Name);
+	int fd = shm_open(Config.Name, O_CREAT | O_RDWR, 0600);
+	if (fd < 0)
+		return false;
+
+	if (ftruncate(fd, MEM_SHM_SIZE) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* mapped = mmap(NULL, MEM_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return false;
+
+	EmuRam = (uint8_t*)mapped;
+#endif
+	return true;
+}
+
+static void DestroyRam(void)
+{
+#if defined(_WIN32)
+	UnmapViewOfFile(EmuRam);
+	CloseHandle(Mapping);
+#else
+	munmap(EmuRam, MEM_SHM_SIZE);
+	shm_unlink(Config.Name);
+#endif
+	EmuRam = NULL;
+}
+
+// tell the user how to point the linux backend at us, it needs where EmuRam is from the start of our executable
+static void PrintAttachInfo(void)
+{
+	printf("RAM is shared as %s\n", Config.Name);
+
+#if defined(__linux__)
+	FILE* maps = fopen("/proc/self/maps", "r");
+	if (maps == NULL)
+		return;
+
+	unsigned long base = 0;
+	if (fscanf(maps, "%lx", &base) == 1)
+		printf("attach with SCUD_EMU_PROCESS=fakemodel SCUD_EMU_PTR=%lx\n", (unsigned long)((uintptr_t)&EmuRam - base));
+	fclose(maps);
+#endif
+}
+
+static void SetState(uint8_t state)
+{
+	RamWriteByte(gMainState, state);
+	StateFrames = 0;
+
+	switch (state)
+	{
+		case msAtractMode:
+			printf("attract\n");
+			break;
+		case msMainMenu:
+			printf("main menu\n");
+			break;
+		case msLoading:
+			printf("loading\n");
+			break;
+		case msRollingStart:
+			printf("rolling start\n");
+			break;
+		case msPreRacing:
+			printf("pre racing\n");
+			break;
+		case msRacing:
+			printf("racing\n");
+			RamWriteInt(gMainTimer, RACE_TIMER_START);
+			break;
+	}
+}
+
+// the scripted local car drives laps of an oval, a circle stretched along X
+static void DriveLocalCar(double time)
+{
+	const float radius = 300.0f;
+	const float stretch = 1.5f;
+	const float speed = 80.0f;
+
+	float angle = (float)(time * speed / radius);
+	float x = cosf(angle) * radius * stretch;
+	float z = sinf(angle) * radius;
+
+	// the direction of travel is the derivative of the position
+	float dx = -sinf(angle) * stretch;
+	float dz = cosf(angle);
+
+	uint32_t base = pBase[0];
+	RamWriteFloat(base + bXPos, x);
+	RamWriteFloat(base + bYPos, 2.0f * sinf(angle * 3));
+	RamWriteFloat(base + bZPos, z);
+	RamWriteFloat(base + bPitch, 0.05f * cosf(angle * 3));
+	RamWriteFloat(base + bYaw, atan2f(dz, dx));
+	RamWriteFloat(base + bSpeed, speed * sqrtf(dx * dx + dz * dz) * 3.6f);
+
+	// brake for a moment at the same place every lap
+	float lap = fmodf(angle, 6.2831853f);
+	RamWriteByte(base + bBrakeLight, (uint8_t)(lap > 3.0f && lap < 3.3f));
+}
+
+// say what the client has done to the other car slots
+static void PrintRemoteCars(void)
+{
+	int remote = 0;
+	printf("timer %u", RamReadInt(gMainTimer));
+	for (int i = 1; i < MAX_PLAYERS; i++)
+	{
+		// the client turns the AI off for every car it drives
+		if (RamReadInt(pBase[i] + bAIAccel) != 0xFFFFFFFF)
+			continue;
+
+		remote++;
+		printf(" | car %d at %.1f %.1f %.1f", i, RamReadFloat(pBase[i] + bXPos), RamReadFloat(pBase[i] + bYPos), RamReadFloat(pBase[i] + bZPos));
+	}
+	printf(" | %d remote\n", remote);
+}
+
+// run one frame of the game
+static void RunFrame(double time)
+{
+	uint32_t seconds = StateFrames * FRAME_PERIOD / 1000000;
+	uint8_t state = RamReadByte(gMainState);
+
+	// gPauseGame 0 holds the game where it is, the client uses it to keep players together
+	bool paused = RamReadByte(gPauseGame) == 0;
+
+	switch (state)
+	{
+		case msAtractMode:
+			if (seconds >= ATTRACT_TIME && !paused)
+				SetState(msMainMenu);
+			break;
+
+		case msMainMenu:
+			if (seconds >= MENU_TIME)
+				SetState(msLoading);
+			break;
+
+		case msLoading:
+			if (seconds >= LOADING_TIME && !paused)
+				SetState(msRollingStart);
+			break;
+
+		case msRollingStart:
+			DriveLocalCar(time);
+			if (seconds >= ROLLING_START_TIME)
+				SetState(msPreRacing);
+			break;
+
+		case msPreRacing:
+			DriveLocalCar(time);
+			if (seconds >= PRE_RACING_TIME)
+				SetState(msRacing);
+			break;
+
+		case msRacing:
+		{
+			DriveLocalCar(time);
+
+			// the race ends when the timer runs out or the race is over
+			uint32_t timer = RamReadInt(gMainTimer);
+			if (timer > 0)
+				RamWriteInt(gMainTimer, timer - 1);
+
+			if (StateFrames % STATUS_INTERVAL == 0)
+				PrintRemoteCars();
+
+			if (timer <= 1 || seconds >= (uint32_t)Config.RaceTime)
+				SetState(msAtractMode);
+			break;
+		}
+
+		default:
+			SetState(msAtractMode);
+			break;
+	}
+
+	StateFrames++;
+}
+
+static void PrintUsage(void)
+{
+	printf("usage: fakemodel [-time seconds] [-race seconds] [-car N] [-number N] [-name segment] [-order host|big]\n");
+}
+
+static bool ParseArgs(int argc, char** argv)
+{
+	Config.Duration = 0;
+	Config.RaceTime = DEFAULT_RACE_TIME;
+	Config.Car = cF40;
+	Config.CarNumber = 1;
+	Config.BigEndian = false;
+	Config.Name = getenv("SCUD_SHM_NAME");
+	if (Config.Name == NULL)
+		Config.Name = MEM_SHM_NAME;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+			return false;
+
+		const char* value = argv[++i];
+		if (strcmp(argv[i - 1], "-time") == 0)
+			Config.Duration = atoi(value);
+		else if (strcmp(argv[i - 1], "-race") == 0)
+			Config.RaceTime = atoi(value);
+		else if (strcmp(argv[i - 1], "-car") == 0)
+			Config.Car = atoi(value);
+		else if (strcmp(argv[i - 1], "-number") == 0)
+			Config.CarNumber = atoi(value);
+		else if (strcmp(argv[i - 1], "-name") == 0)
+			Config.Name = value;
+		else if (strcmp(argv[i - 1], "-order") == 0)
+			Config.BigEndian = strcmp(value, "big") == 0;
+		else
+			return false;
+	}
+
+	return Config.Duration >= 0 && Config.RaceTime > 0 && Config.Car >= 0 && Config.Car < (int)(sizeof(CarValues) / sizeof(CarValues[0]));
+}
+
+int main(int argc, char** argv)
+{
+	if (!ParseArgs(argc, argv))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (!CreateRam())
+	{
+		printf("Could not create the shared memory segment %s\n", Config.Name);
+		return 1;
+	}
+
+	PrintAttachInfo();
+
+	// the game starts unpaused, with the local player's car chosen
+	RamWriteByte(gPauseGame, 1);
+	RamWriteByte(gLocalPlayerCar, (uint8_t)Config.Car);
+	RamWriteByte(gCarNumber, (uint8_t)Config.CarNumber);
+	RamWriteByte(gCarCount, 8);
+	RamWriteByte(gRealPlayers, 1);
+	RamWriteByte(pBase[0] + bCarType, CarValues[Config.Car]);
+	RamWriteByte(pBase[0] + bCarNumber, (uint8_t)Config.CarNumber);
+	SetState(msAtractMode);
+	fflush(stdout);
+
+	uint64_t start = NetTimeMicros();
+	uint64_t frame = 0;
+	while (Config.Duration == 0 || NetTimeMicros() - start < (uint64_t)Config.Duration * 1000000)
+	{
+		RunFrame((double)(frame * FRAME_PERIOD) / 1000000.0);
+		fflush(stdout);
+		frame++;
+
+		// wait for the next frame, frames are scheduled from the start so a late one doesn't push the rest back
+		uint64_t next = start + frame * FRAME_PERIOD;
+		uint64_t now = NetTimeMicros();
+		if (next > now)
+			SleepThread((int)((next - now) / 1000));
+	}
+
+	DestroyRam();
+	return 0;
+}
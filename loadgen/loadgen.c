@@ -0,0 +1,1072 @@
+/**********************************************************************************************
+*
+*   raylib_networking_smaple * a sample network game using raylib and enet
+*
+*   LICENSE: ZLIB
+*
+*   Copyright (c) 2023 Jeffery Myers
+*
+*   Permission is hereby granted, free of charge, to any person obtaining a copy
+*   of this software and associated documentation files (the "Software"), to deal
+*   in the Software without restriction, including without limitation the rights
+*   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*   copies of the Software, and to permit persons to whom the Software is
+*   furnished to do so, subject to the following conditions:
+*
+*   The above copyright notice and this permission notice shall be included in all
+*   copies or substantial portions of the Software.
+*
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*   SOFTWARE.
+*
+**********************************************************************************************/
+
+// headless load generator
+// runs thousands of bots that speak the same protocol as the game client, without an emulator.
+// every bot drives laps of a circle, sends its position like the client does, readies up and acks world snapshots.
+// bots are connected one room at a time so the load generator knows who is in each room, that lets a bot
+// find which of its room mates sent each position it receives and time how long the server took to get it there.
+
+#define ENET_IMPLEMENTATION
+#include "net_common.h"
+#include "net_snapshot.h"
+#include "net_messages.h"
+#include "net_batch.h"
+#include "net_thread.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+// defaults for everything that can be set on the command line
+#define DEFAULT_BOTS 64
+#define DEFAULT_SEND_RATE 20
+#define DEFAULT_DURATION 30
+#define DEFAULT_SERVER "127.0.0.1"
+#define SERVER_PORT 4545
+
+// how many bots share one enet host, every host has its own local port so the server's workers get a share of them
+#define BOTS_PER_HOST 64
+
+// how long a bot waits after being accepted before it says it is ready
+#define READY_DELAY 1000000
+
+// how long we wait for a room full of bots to be accepted
+#define CONNECT_TIMEOUT 5000000
+
+// how many of its own sent positions a bot remembers, so a room mate can find out when one was sent
+// must be a power of two
+#define SAMPLE_HISTORY 64
+
+// a received position has to be this close to a sent one to be counted as the same
+#define SAMPLE_MATCH_DISTANCE 0.5f
+
+// the latency histograms have 0.1ms buckets up to one second, anything slower goes into the last one
+#define LATENCY_BUCKETS 10000
+#define LATENCY_BUCKET_SIZE 100
+
+// the game reads the local car from the emulator once a frame, at 57.5 frames a second
+#define FRAME_PERIOD 17391
+
+#define MAX_THREADS 64
+
+// how the load generator was asked to run
+typedef struct
+{
+	int Bots;
+	int RoomSize;
+	int SendRate;
+	int Duration;
+	int Threads;
+
+	// percent of state packets thrown away, in both directions
+	float Loss;
+
+	// the most a state packet is held back, in both directions
+	int JitterMs;
+
+	// ask the server for the timing of every car, and break the latency down into stages
+	bool Latency;
+
+	const char* Server;
+}LoadConfig;
+
+// one position a bot sent, and when
+typedef struct
+{
+	// when the position was read, the start of the frame it was read in
+	uint64_t ReadTime;
+
+	// when it was given to enet
+	uint64_t SendTime;
+
+	float X;
+	float Z;
+}SentSample;
+
+// one simulated client
+typedef struct
+{
+	int Index;
+
+	ENetPeer* Peer;
+
+	// the room the bot was connected as part of and the player id the server gave it, -1 until accepted
+	int Room;
+	int PlayerId;
+
+	bool Ready;
+	bool Disconnected;
+	uint64_t AcceptTime;
+
+	// the lap the bot drives
+	float LapRadius;
+	float LapSpeed;
+	float LapAngle;
+	uint64_t NextSend;
+
+	// the positions we sent most recently
+	SentSample Sent[SAMPLE_HISTORY];
+	uint32_t SentCount;
+
+	// the world as the bot has received it
+	uint32_t LastWorldTick;
+	SnapshotHistory WorldHistory;
+	CarState LastSeen[MAX_PLAYERS];
+	uint8_t SeenPresent;
+
+	// the number of the last position we saw from each room mate
+	uint32_t LastMatched[MAX_PLAYERS];
+}Bot;
+
+// which bot the server gave each player id in a room we filled
+typedef struct
+{
+	int Bots[MAX_PLAYERS];
+}BotRoom;
+
+// how long something took, in LATENCY_BUCKET_SIZE microsecond buckets
+typedef struct
+{
+	uint64_t Count;
+	uint64_t Max;
+	uint32_t Buckets[LATENCY_BUCKETS];
+}LatencyHistogram;
+
+// the stages a position goes through on the way from one player to another
+typedef enum
+{
+	// read from the game until it arrives at a room mate
+	StageTotal = 0,
+
+	// read from the game until it is given to enet, waiting for the next send
+	StageSendWait,
+
+	// in enet and on the wire, both to the server and back out again
+	StageTransit,
+
+	// on the server, waiting for the next tick
+	StageRelay,
+
+	// received by enet until the room mate handled it
+	StageDrain,
+
+	StageCount,
+}LatencyStage;
+
+static const char* StageNames[StageCount] = { "total", "send wait", "enet+wire", "server relay", "drain" };
+
+// everything a thread has counted
+typedef struct
+{
+	uint64_t InputsSent;
+	uint64_t BytesSent;
+	uint64_t SnapshotsReceived;
+	uint64_t BytesReceived;
+
+	// positions a room mate sent that never showed up in a snapshot
+	// with the server ticking at least as fast as the bots send, these were lost somewhere on the way
+	uint64_t Missed;
+
+	// snapshots that arrived after a newer one
+	uint64_t Stale;
+
+	// snapshots we could not decode, because the baseline was not in our history
+	uint64_t BadSnapshots;
+
+	// positions we could not match to anything a room mate sent
+	uint64_t Unmatched;
+
+	// packets the impairment threw away
+	uint64_t ImpairedLost;
+
+	uint64_t RaceStarts;
+	uint64_t Disconnects;
+
+	// sent until received by a room mate
+	LatencyHistogram FanOut;
+
+	// only filled in when measuring latency
+	LatencyHistogram Stages[StageCount];
+}LoadStats;
+
+// a state packet held back by the impairment
+typedef struct
+{
+	uint64_t Release;
+	Bot* Bot;
+	ENetPacket* Packet;
+
+	// received packets are handled when they are released, the others are sent
+	bool Inbound;
+}DelayedPacket;
+
+// one thread of bots, it owns every host it services and every bot on them
+typedef struct
+{
+	int Index;
+
+	ENetHost** Hosts;
+	int HostCount;
+
+	// the stats since the last report and since the start
+	LoadStats Interval;
+	LoadStats Total;
+
+	// a min heap of held back packets, ordered by release time
+	DelayedPacket* Delayed;
+	int DelayedCount;
+	int DelayedCapacity;
+
+	uint32_t Random;
+
+	NetThread Thread;
+}LoadThread;
+
+static LoadConfig Config;
+static Bot* Bots;
+static BotRoom* Rooms;
+static uint64_t SendInterval;
+static uint64_t EndTime;
+
+// xorshift, each thread has its own so the impairment doesn't need a lock
+static uint32_t NextRandom(LoadThread* thread)
+{
+	uint32_t x = thread->Random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	thread->Random = x;
+	return x;
+}
+
+static void AddLatency(LatencyHistogram* histogram, uint64_t micros)
+{
+	uint64_t bucket = micros / LATENCY_BUCKET_SIZE;
+	if (bucket >= LATENCY_BUCKETS)
+		bucket = LATENCY_BUCKETS - 1;
+
+	histogram->Buckets[bucket]++;
+	histogram->Count++;
+	if (micros > histogram->Max)
+		histogram->Max = micros;
+}
+
+// the latency in milliseconds that a fraction of the samples are at or below
+static double GetPercentile(const LatencyHistogram* histogram, double fraction)
+{
+	if (histogram->Count == 0)
+		return 0;
+
+	uint64_t target = (uint64_t)ceil(fraction * (double)histogram->Count);
+	uint64_t count = 0;
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		count += histogram->Buckets[i];
+		if (count >= target)
+			return ((i + 1) * LATENCY_BUCKET_SIZE) / 1000.0;
+	}
+	return histogram->Max / 1000.0;
+}
+
+static void MergeHistogram(LatencyHistogram* into, const LatencyHistogram* from)
+{
+	into->Count += from->Count;
+	if (from->Max > into->Max)
+		into->Max = from->Max;
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+		into->Buckets[i] += from->Buckets[i];
+}
+
+static void MergeStats(LoadStats* into, const LoadStats* from)
+{
+	into->InputsSent += from->InputsSent;
+	into->BytesSent += from->BytesSent;
+	into->SnapshotsReceived += from->SnapshotsReceived;
+	into->BytesReceived += from->BytesReceived;
+	into->Missed += from->Missed;
+	into->Stale += from->Stale;
+	into->BadSnapshots += from->BadSnapshots;
+	into->Unmatched += from->Unmatched;
+	into->ImpairedLost += from->ImpairedLost;
+	into->RaceStarts += from->RaceStarts;
+	into->Disconnects += from->Disconnects;
+
+	MergeHistogram(&into->FanOut, &from->FanOut);
+	for (int i = 0; i < StageCount; i++)
+		MergeHistogram(&into->Stages[i], &from->Stages[i]);
+}
+
+static void PrintStats(const char* label, const LoadStats* stats, double seconds)
+{
+	printf("%s in %.0f msg/s %.1f KB/s, out %.0f snapshots/s %.1f KB/s, fan-out ms p50 %.1f p95 %.1f p99 %.1f max %.1f, missed %llu stale %llu bad %llu unmatched %llu impaired %llu, race starts %llu disconnects %llu\n",
+		label, stats->InputsSent / seconds, stats->BytesSent / seconds / 1024.0, stats->SnapshotsReceived / seconds, stats->BytesReceived / seconds / 1024.0,
+		GetPercentile(&stats->FanOut, 0.5), GetPercentile(&stats->FanOut, 0.95), GetPercentile(&stats->FanOut, 0.99), stats->FanOut.Max / 1000.0,
+		(unsigned long long)stats->Missed, (unsigned long long)stats->Stale, (unsigned long long)stats->BadSnapshots, (unsigned long long)stats->Unmatched,
+		(unsigned long long)stats->ImpairedLost, (unsigned long long)stats->RaceStarts, (unsigned long long)stats->Disconnects);
+}
+
+// p50/p95/p99/max of every stage, in milliseconds
+static void PrintStages(const char* label, const LoadStats* stats)
+{
+	printf("%s latency ms p50/p95/p99/max", label);
+	for (int i = 0; i < StageCount; i++)
+	{
+		const LatencyHistogram* stage = &stats->Stages[i];
+		printf("%s %s %.1f/%.1f/%.1f/%.1f", i > 0 ? "," : "", StageNames[i], GetPercentile(stage, 0.5), GetPercentile(stage, 0.95),
+			GetPercentile(stage, 0.99), stage->Max / 1000.0);
+	}
+	printf("\n");
+}
+
+// held back packets
+
+static void SwapDelayed(DelayedPacket* a, DelayedPacket* b)
+{
+	DelayedPacket temp = *a;
+	*a = *b;
+	*b = temp;
+}
+
+static bool PushDelayed(LoadThread* thread, DelayedPacket delayed)
+{
+	if (thread->DelayedCount == thread->DelayedCapacity)
+	{
+		int capacity = thread->DelayedCapacity > 0 ? thread->DelayedCapacity * 2 : 1024;
+		DelayedPacket* grown = (DelayedPacket*)realloc(thread->Delayed, capacity * sizeof(DelayedPacket));
+		if (grown == NULL)
+			return false;
+
+		thread->Delayed = grown;
+		thread->DelayedCapacity = capacity;
+	}
+
+	int i = thread->DelayedCount++;
+	thread->Delayed[i] = delayed;
+	while (i > 0 && thread->Delayed[(i - 1) / 2].Release > thread->Delayed[i].Release)
+	{
+		SwapDelayed(&thread->Delayed[(i - 1) / 2], &thread->Delayed[i]);
+		i = (i - 1) / 2;
+	}
+	return true;
+}
+
+static DelayedPacket PopDelayed(LoadThread* thread)
+{
+	DelayedPacket top = thread->Delayed[0];
+	thread->Delayed[0] = thread->Delayed[--thread->DelayedCount];
+
+	int i = 0;
+	while (true)
+	{
+		int smallest = i;
+		int left = i * 2 + 1;
+		int right = left + 1;
+		if (left < thread->DelayedCount && thread->Delayed[left].Release < thread->Delayed[smallest].Release)
+			smallest = left;
+		if (right < thread->DelayedCount && thread->Delayed[right].Release < thread->Delayed[smallest].Release)
+			smallest = right;
+		if (smallest == i)
+			break;
+
+		SwapDelayed(&thread->Delayed[i], &thread->Delayed[smallest]);
+		i = smallest;
+	}
+	return top;
+}
+
+// the impairment, decides if a state packet is lost and how long it is held back
+// returns false if the packet was lost, otherwise delay is how long to hold it
+static bool Impair(LoadThread* thread, uint64_t* delay)
+{
+	*delay = 0;
+	if (Config.Loss > 0 && (NextRandom(thread) % 10000) < (uint32_t)(Config.Loss * 100))
+	{
+		thread->Interval.ImpairedLost++;
+		return false;
+	}
+
+	if (Config.JitterMs > 0)
+		*delay = NextRandom(thread) % ((uint64_t)Config.JitterMs * 1000);
+
+	return true;
+}
+
+// send a state packet through the impairment
+static void SendState(LoadThread* thread, Bot* bot, ENetPacket* packet, uint64_t now)
+{
+	uint64_t delay = 0;
+	if (!Impair(thread, &delay))
+	{
+		enet_packet_destroy(packet);
+		return;
+	}
+
+	if (delay > 0)
+	{
+		DelayedPacket delayed = { now + delay, bot, packet, false };
+		if (PushDelayed(thread, delayed))
+			return;
+	}
+
+	enet_peer_send(bot->Peer, CHANNEL_STATE, packet);
+}
+
+// bots
+
+// where the bot is on its lap, and send it to the server the same way the game client does
+static void SendInput(LoadThread* thread, Bot* bot, uint64_t now)
+{
+	bot->LapAngle += bot->LapSpeed / bot->LapRadius * ((float)SendInterval / 1000000.0f);
+	if (bot->LapAngle > 6.2831853f)
+		bot->LapAngle -= 6.2831853f;
+
+	float x = cosf(bot->LapAngle) * bot->LapRadius;
+	float z = sinf(bot->LapAngle) * bot->LapRadius;
+
+	UpdateInputMessage input = { 0 };
+	input.Car.X = x;
+	input.Car.Z = z;
+	input.Car.Pitch = sinf(bot->LapAngle * 4) * 0.05f;
+	input.Car.Yaw = bot->LapAngle + 1.5707963f;
+	input.Car.Speed = bot->LapSpeed * 3.6f;
+	input.Car.BrakeLight = bot->LapAngle > 3.0f && bot->LapAngle < 3.5f;
+	input.Car.Car = (uint8_t)(bot->Index % 8);
+	input.Car.CarNumber = (uint8_t)bot->Index;
+	input.SampleTime = (uint32_t)now;
+
+	ENetPacket* packet = CreateUpdateInputPacket(&input, 0);
+	if (packet == NULL)
+		return;
+
+	// like the game, the position we send is the one read at the start of the current frame, every bot's frames start at a different time
+	uint64_t frameOffset = (uint64_t)bot->Index * 997;
+	SentSample* sample = &bot->Sent[bot->SentCount++ & (SAMPLE_HISTORY - 1)];
+	sample->ReadTime = now - ((now + frameOffset) % FRAME_PERIOD);
+	sample->SendTime = now;
+	sample->X = x;
+	sample->Z = z;
+
+	thread->Interval.InputsSent++;
+	thread->Interval.BytesSent += packet->dataLength;
+	SendState(thread, bot, packet, now);
+}
+
+static void SendReady(Bot* bot)
+{
+	PlayerIsReadyMessage ready = { 0 };
+	ENetPacket* packet = CreatePlayerIsReadyPacket(&ready, ENET_PACKET_FLAG_RELIABLE);
+	if (packet != NULL)
+		enet_peer_send(bot->Peer, CHANNEL_CONTROL, packet);
+
+	bot->Ready = true;
+}
+
+// count a position from a room mate that we found in what they sent
+// number is which position it was, counting from 1
+static void AddSample(LoadThread* thread, Bot* bot, int playerId, const SentSample* sample, uint32_t number, const CarState* car, uint64_t receiveTime)
+{
+	uint64_t handled = NetTimeMicros();
+	AddLatency(&thread->Interval.FanOut, handled - sample->SendTime);
+
+	if (Config.Latency)
+	{
+		uint64_t total = handled - sample->ReadTime;
+		uint64_t sendWait = sample->SendTime - sample->ReadTime;
+		uint64_t relay = (uint64_t)car->RelayDelay * SNAPSHOT_RELAY_UNIT;
+		uint64_t drain = handled - receiveTime;
+
+		// whatever is left is enet and the network, the clocks are microseconds so it can come out a little under 0
+		uint64_t known = sendWait + relay + drain;
+		uint64_t transit = total > known ? total - known : 0;
+
+		AddLatency(&thread->Interval.Stages[StageTotal], total);
+		AddLatency(&thread->Interval.Stages[StageSendWait], sendWait);
+		AddLatency(&thread->Interval.Stages[StageTransit], transit);
+		AddLatency(&thread->Interval.Stages[StageRelay], relay);
+		AddLatency(&thread->Interval.Stages[StageDrain], drain);
+	}
+
+	if (bot->LastMatched[playerId] != 0 && number > bot->LastMatched[playerId] + 1)
+		thread->Interval.Missed += number - bot->LastMatched[playerId] - 1;
+	if (number > bot->LastMatched[playerId])
+		bot->LastMatched[playerId] = number;
+}
+
+// find when a room mate sent a position we just received
+// with timing the server tells us when it was sent, otherwise look for the position itself
+static void MatchSample(LoadThread* thread, Bot* bot, int playerId, const CarState* car, uint64_t receiveTime)
+{
+	int sender = Rooms[bot->Room].Bots[playerId];
+	if (sender < 0)
+	{
+		thread->Interval.Unmatched++;
+		return;
+	}
+
+	// newest first, the position is almost always one of the last few sent
+	const Bot* from = &Bots[sender];
+	uint32_t count = from->SentCount < SAMPLE_HISTORY ? from->SentCount : SAMPLE_HISTORY;
+	for (uint32_t i = 1; i <= count; i++)
+	{
+		const SentSample* sample = &from->Sent[(from->SentCount - i) & (SAMPLE_HISTORY - 1)];
+
+		bool match = false;
+		if (Config.Latency)
+			match = (uint32_t)sample->SendTime == car->SampleTime;
+		else
+			match = fabsf(sample->X - car->X) + fabsf(sample->Z - car->Z) < SAMPLE_MATCH_DISTANCE;
+
+		if (match)
+		{
+			AddSample(thread, bot, playerId, sample, from->SentCount - i + 1, car, receiveTime);
+			return;
+		}
+	}
+
+	thread->Interval.Unmatched++;
+}
+
+static void HandleUpdateWorld(LoadThread* thread, Bot* bot, PacketReader* reader, uint64_t receiveTime)
+{
+	WorldSnapshot world;
+	if (!ReadWorldSnapshot(reader, &bot->WorldHistory, &world))
+	{
+		thread->Interval.BadSnapshots++;
+		return;
+	}
+
+	if (world.Tick <= bot->LastWorldTick)
+	{
+		thread->Interval.Stale++;
+		return;
+	}
+
+	bot->LastWorldTick = world.Tick;
+	*StoreSnapshot(&bot->WorldHistory, world.Tick) = world;
+
+	AckWorldMessage ack = { 0 };
+	ack.Tick = world.Tick;
+	ENetPacket* ackPacket = CreateAckWorldPacket(&ack, 0);
+	if (ackPacket != NULL)
+		SendState(thread, bot, ackPacket, receiveTime);
+
+	// only time the cars that changed, an unchanged car is still the position we timed last time
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (!(world.Present & (1 << i)) || i == bot->PlayerId)
+			continue;
+
+		const CarState* car = &world.Cars[i];
+		bool changed = Config.Latency ? car->SampleTime != bot->LastSeen[i].SampleTime : (car->X != bot->LastSeen[i].X || car->Z != bot->LastSeen[i].Z);
+		if (!(bot->SeenPresent & (1 << i)) || changed)
+			MatchSample(thread, bot, i, car, receiveTime);
+
+		bot->LastSeen[i] = *car;
+	}
+	bot->SeenPresent = world.Present;
+}
+
+// receiveTime is when enet gave us the packet
+static void HandleReceive(LoadThread* thread, Bot* bot, ENetPacket* packet, uint64_t receiveTime)
+{
+	if (packet->dataLength < 1)
+		return;
+
+	thread->Interval.BytesReceived += packet->dataLength;
+
+	PacketReader reader;
+	BeginRead(&reader, packet);
+
+	// a packet is one message or a batch of them
+	PacketReader message;
+	while (BatchNext(&reader, &message))
+	{
+		switch ((NetworkCommands)message.Data[0])
+		{
+		case UpdateWorld:
+			thread->Interval.SnapshotsReceived++;
+			HandleUpdateWorld(thread, bot, &message, receiveTime);
+			break;
+
+		case RaceStart:
+			thread->Interval.RaceStarts++;
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+// one event for a bot after the connect phase, now is when enet received it
+static void HandleBotEvent(LoadThread* thread, ENetEvent* event, uint64_t now)
+{
+	Bot* bot = (Bot*)enet_peer_get_data(event->peer);
+	if (bot == NULL)
+	{
+		if (event->type == ENET_EVENT_TYPE_RECEIVE)
+			enet_packet_destroy(event->packet);
+		return;
+	}
+
+	switch (event->type)
+	{
+	case ENET_EVENT_TYPE_RECEIVE:
+	{
+		// snapshots go through the impairment, the control channel is reliable so enet would resend anything we dropped
+		uint64_t delay = 0;
+		if (event->channelID == CHANNEL_STATE && !Impair(thread, &delay))
+		{
+			enet_packet_destroy(event->packet);
+			break;
+		}
+
+		if (delay > 0)
+		{
+			DelayedPacket delayed = { now + delay, bot, event->packet, true };
+			if (PushDelayed(thread, delayed))
+				break;
+		}
+
+		HandleReceive(thread, bot, event->packet, now);
+		enet_packet_destroy(event->packet);
+		break;
+	}
+
+	case ENET_EVENT_TYPE_DISCONNECT:
+	case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
+		if (!bot->Disconnected)
+			thread->Interval.Disconnects++;
+		bot->Disconnected = true;
+		bot->Peer = NULL;
+		enet_peer_set_data(event->peer, NULL);
+		break;
+
+	default:
+		break;
+	}
+}
+
+// wait on every host's socket at once, until something arrives or the timeout runs out
+static void WaitForHosts(LoadThread* thread, uint32_t timeout)
+{
+	ENetSocketSet readSet;
+	ENET_SOCKETSET_EMPTY(readSet);
+
+	ENetSocket maxSocket = 0;
+	for (int i = 0; i < thread->HostCount; i++)
+	{
+		ENET_SOCKETSET_ADD(readSet, thread->Hosts[i]->socket);
+		if (thread->Hosts[i]->socket > maxSocket)
+			maxSocket = thread->Hosts[i]->socket;
+	}
+
+	enet_socketset_select(maxSocket, &readSet, NULL, timeout);
+}
+
+// the loop every bot thread runs until the test is over
+static void ThreadMain(void* arg)
+{
+	LoadThread* thread = (LoadThread*)arg;
+
+	uint64_t start = NetTimeMicros();
+	uint64_t nextReport = start + 1000000;
+
+	while (true)
+	{
+		uint64_t now = NetTimeMicros();
+		if (now >= EndTime)
+			break;
+
+		// release anything the impairment was holding
+		while (thread->DelayedCount > 0 && thread->Delayed[0].Release <= now)
+		{
+			DelayedPacket delayed = PopDelayed(thread);
+			if (delayed.Inbound)
+			{
+				HandleReceive(thread, delayed.Bot, delayed.Packet, now);
+				enet_packet_destroy(delayed.Packet);
+			}
+			else if (delayed.Bot->Peer != NULL)
+			{
+				enet_peer_send(delayed.Bot->Peer, CHANNEL_STATE, delayed.Packet);
+			}
+			else
+			{
+				enet_packet_destroy(delayed.Packet);
+			}
+		}
+
+		// every bot sends on its own schedule
+		uint64_t nextWake = now + 1000;
+		for (int h = 0; h < thread->HostCount; h++)
+		{
+			ENetHost* host = thread->Hosts[h];
+			for (size_t p = 0; p < host->peerCount; p++)
+			{
+				Bot* bot = (Bot*)enet_peer_get_data(&host->peers[p]);
+				if (bot == NULL || bot->Disconnected)
+					continue;
+
+				if (now >= bot->NextSend)
+				{
+					SendInput(thread, bot, now);
+
+					// stay on schedule, unless we fell a whole interval behind
+					bot->NextSend += SendInterval;
+					if (bot->NextSend <= now)
+						bot->NextSend = now + SendInterval;
+				}
+
+				if (!bot->Ready && now >= bot->AcceptTime + READY_DELAY)
+					SendReady(bot);
+
+				if (bot->NextSend < nextWake)
+					nextWake = bot->NextSend;
+			}
+		}
+
+		// send what we queued and handle everything that came in
+		for (int h = 0; h < thread->HostCount; h++)
+		{
+			ENetEvent event;
+			if (enet_host_service(thread->Hosts[h], &event, 0) > 0)
+			{
+				// everything we get out of check_events was received by this service call
+				uint64_t received = NetTimeMicros();
+				do
+				{
+					HandleBotEvent(thread, &event, received);
+				} while (enet_host_check_events(thread->Hosts[h], &event) > 0);
+			}
+		}
+
+		now = NetTimeMicros();
+		if (now >= nextReport)
+		{
+			char label[32];
+			snprintf(label, sizeof(label), "[thread %d]", thread->Index);
+			PrintStats(label, &thread->Interval, (now - nextReport + 1000000) / 1000000.0);
+			if (Config.Latency)
+				PrintStages(label, &thread->Interval);
+
+			MergeStats(&thread->Total, &thread->Interval);
+			memset(&thread->Interval, 0, sizeof(LoadStats));
+			nextReport = now + 1000000;
+		}
+
+		if (thread->DelayedCount > 0 && thread->Delayed[0].Release < nextWake)
+			nextWake = thread->Delayed[0].Release;
+
+		// sleep until the next send or until something arrives
+		if (nextWake > now)
+			WaitForHosts(thread, (uint32_t)((nextWake - now + 999) / 1000));
+	}
+
+	MergeStats(&thread->Total, &thread->Interval);
+	memset(&thread->Interval, 0, sizeof(LoadStats));
+
+	// anything still held back is never sent
+	while (thread->DelayedCount > 0)
+		enet_packet_destroy(PopDelayed(thread).Packet);
+}
+
+// connecting
+
+// handle one event while bots are connecting, the only thing we care about is who got accepted
+static void HandleConnectEvent(ENetEvent* event, uint64_t now)
+{
+	Bot* bot = (Bot*)enet_peer_get_data(event->peer);
+
+	if (event->type == ENET_EVENT_TYPE_RECEIVE)
+	{
+		PacketReader reader;
+		BeginRead(&reader, event->packet);
+
+		// the accept comes first in its batch, the add messages after it don't matter to a bot
+		PacketReader message;
+		AcceptPlayerMessage accept;
+		if (bot != NULL && bot->PlayerId < 0 && BatchNext(&reader, &message) && PacketReadAcceptPlayer(&message, &accept))
+		{
+			int playerId = accept.PlayerId;
+			if (playerId < MAX_PLAYERS)
+			{
+				bot->PlayerId = playerId;
+				bot->AcceptTime = now;
+				bot->NextSend = now;
+				Rooms[bot->Room].Bots[playerId] = bot->Index;
+			}
+		}
+		enet_packet_destroy(event->packet);
+	}
+	else if ((event->type == ENET_EVENT_TYPE_DISCONNECT || event->type == ENET_EVENT_TYPE_DISCONNECT_TIMEOUT) && bot != NULL)
+	{
+		bot->Disconnected = true;
+		bot->Peer = NULL;
+		enet_peer_set_data(event->peer, NULL);
+	}
+}
+
+// connect one room full of bots from the same host and wait for the server to accept all of them
+// rooms are filled one at a time so we know every bot in the room is one of ours
+static bool ConnectRoom(ENetHost** hosts, int hostCount, ENetHost* host, ENetAddress* address, int room)
+{
+	int first = room * Config.RoomSize;
+	for (int i = first; i < first + Config.RoomSize; i++)
+	{
+		Bot* bot = &Bots[i];
+		enet_uint32 connectData = (enet_uint32)Config.RoomSize | (Config.Latency ? CONNECT_WANTS_TIMING : 0);
+		bot->Peer = enet_host_connect(host, address, CHANNEL_COUNT, connectData);
+		if (bot->Peer == NULL)
+			return false;
+
+		enet_peer_set_data(bot->Peer, bot);
+	}
+
+	uint64_t timeout = NetTimeMicros() + CONNECT_TIMEOUT;
+	while (NetTimeMicros() < timeout)
+	{
+		// keep every host serviced, so the bots that are already connected don't time out
+		uint64_t now = NetTimeMicros();
+		for (int h = 0; h < hostCount; h++)
+		{
+			ENetEvent event;
+			while (enet_host_service(hosts[h], &event, 0) > 0)
+				HandleConnectEvent(&event, now);
+		}
+
+		int accepted = 0;
+		for (int i = first; i < first + Config.RoomSize; i++)
+		{
+			if (Bots[i].Disconnected)
+				return false;
+			if (Bots[i].PlayerId >= 0)
+				accepted++;
+		}
+
+		if (accepted == Config.RoomSize)
+			return true;
+
+		ENetSocketSet readSet;
+		ENET_SOCKETSET_EMPTY(readSet);
+		ENET_SOCKETSET_ADD(readSet, host->socket);
+		enet_socketset_select(host->socket, &readSet, NULL, 1);
+	}
+
+	return false;
+}
+
+static void PrintUsage(void)
+{
+	printf("usage: loadgen [-bots N] [-room N] [-rate Hz] [-time seconds] [-threads N] [-loss percent] [-jitter ms] [-server address] [-latency]\n");
+}
+
+static bool ParseArgs(int argc, char** argv)
+{
+	Config.Bots = DEFAULT_BOTS;
+	Config.RoomSize = MAX_PLAYERS;
+	Config.SendRate = DEFAULT_SEND_RATE;
+	Config.Duration = DEFAULT_DURATION;
+	Config.Threads = 1;
+	Config.Loss = 0;
+	Config.JitterMs = 0;
+	Config.Server = DEFAULT_SERVER;
+	Config.Latency = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-latency") == 0)
+		{
+			Config.Latency = true;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+			return false;
+
+		const char* value = argv[++i];
+		if (strcmp(argv[i - 1], "-bots") == 0)
+			Config.Bots = atoi(value);
+		else if (strcmp(argv[i - 1], "-room") == 0)
+			Config.RoomSize = atoi(value);
+		else if (strcmp(argv[i - 1], "-rate") == 0)
+			Config.SendRate = atoi(value);
+		else if (strcmp(argv[i - 1], "-time") == 0)
+			Config.Duration = atoi(value);
+		else if (strcmp(argv[i - 1], "-threads") == 0)
+			Config.Threads = atoi(value);
+		else if (strcmp(argv[i - 1], "-loss") == 0)
+			Config.Loss = (float)atof(value);
+		else if (strcmp(argv[i - 1], "-jitter") == 0)
+			Config.JitterMs = atoi(value);
+		else if (strcmp(argv[i - 1], "-server") == 0)
+			Config.Server = value;
+		else
+			return false;
+	}
+
+	// the server won't run a race for one player
+	return Config.RoomSize >= 2 && Config.RoomSize <= MAX_PLAYERS && Config.Bots >= Config.RoomSize && Config.SendRate > 0 && Config.SendRate <= 1000
+		&& Config.Duration > 0 && Config.Threads > 0 && Config.Threads <= MAX_THREADS && Config.Loss >= 0 && Config.Loss <= 100 && Config.JitterMs >= 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (!ParseArgs(argc, argv))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (enet_initialize() != 0)
+		return 1;
+
+	// only whole rooms, and a host never splits a room
+	int roomCount = Config.Bots / Config.RoomSize;
+	int roomsPerHost = BOTS_PER_HOST / Config.RoomSize;
+	int hostCount = (roomCount + roomsPerHost - 1) / roomsPerHost;
+	int botCount = roomCount * Config.RoomSize;
+	if (Config.Threads > hostCount)
+		Config.Threads = hostCount;
+
+	Bots = (Bot*)calloc(botCount, sizeof(Bot));
+	Rooms = (BotRoom*)malloc(roomCount * sizeof(BotRoom));
+	ENetHost** hosts = (ENetHost**)calloc(hostCount, sizeof(ENetHost*));
+	if (Bots == NULL || Rooms == NULL || hosts == NULL)
+		return 1;
+
+	for (int r = 0; r < roomCount; r++)
+	{
+		for (int p = 0; p < MAX_PLAYERS; p++)
+			Rooms[r].Bots[p] = -1;
+	}
+
+	for (int i = 0; i < botCount; i++)
+	{
+		Bot* bot = &Bots[i];
+		bot->Index = i;
+		bot->Room = i / Config.RoomSize;
+		bot->PlayerId = -1;
+
+		// different laps so the cars are not all in the same place
+		bot->LapRadius = 200.0f + (float)(i % 16) * 25.0f;
+		bot->LapSpeed = 40.0f + (float)(i % 5) * 5.0f;
+		bot->LapAngle = (float)(i % 360) * 0.0174533f;
+	}
+
+	for (int h = 0; h < hostCount; h++)
+	{
+		hosts[h] = enet_host_create(NULL, roomsPerHost * Config.RoomSize, CHANNEL_COUNT, 0, 0);
+		if (hosts[h] == NULL)
+		{
+			printf("Could not create host %d\n", h);
+			return 1;
+		}
+	}
+
+	ENetAddress address = { 0 };
+	enet_address_set_host(&address, Config.Server);
+	address.port = SERVER_PORT;
+
+	printf("Connecting %d bots in %d rooms of %d on %d hosts\n", botCount, roomCount, Config.RoomSize, hostCount);
+
+	for (int r = 0; r < roomCount; r++)
+	{
+		if (!ConnectRoom(hosts, hostCount, hosts[r / roomsPerHost], &address, r))
+		{
+			printf("Room %d was not accepted, is the server running with enough rooms?\n", r);
+			return 1;
+		}
+	}
+
+	printf("Connected, sending at %d Hz for %d seconds on %d threads, %.1f%% loss, %d ms jitter%s\n", Config.SendRate, Config.Duration, Config.Threads,
+		Config.Loss, Config.JitterMs, Config.Latency ? ", measuring latency" : "");
+
+	// the hosts are split between the threads, from here on only the thread that owns a host touches it
+	LoadThread* threads = (LoadThread*)calloc(Config.Threads, sizeof(LoadThread));
+	if (threads == NULL)
+		return 1;
+
+	SendInterval = 1000000 / Config.SendRate;
+	EndTime = NetTimeMicros() + (uint64_t)Config.Duration * 1000000;
+
+	for (int t = 0; t < Config.Threads; t++)
+	{
+		LoadThread* thread = &threads[t];
+		thread->Index = t;
+		thread->Random = 0x9E3779B9u * (uint32_t)(t + 1);
+		thread->Hosts = (ENetHost**)calloc(hostCount, sizeof(ENetHost*));
+		if (thread->Hosts == NULL)
+			return 1;
+
+		for (int h = t; h < hostCount; h += Config.Threads)
+			thread->Hosts[thread->HostCount++] = hosts[h];
+	}
+
+	for (int t = 1; t < Config.Threads; t++)
+	{
+		if (!StartThread(&threads[t].Thread, ThreadMain, &threads[t]))
+			return 1;
+	}
+	ThreadMain(&threads[0]);
+
+	LoadStats total = { 0 };
+	for (int t = 0; t < Config.Threads; t++)
+	{
+		JoinThread(&threads[t].Thread);
+		MergeStats(&total, &threads[t].Total);
+	}
+
+	PrintStats("[total]", &total, (double)Config.Duration);
+	if (Config.Latency)
+		PrintStages("[total]", &total);
+
+	for (int h = 0; h < hostCount; h++)
+	{
+		for (size_t p = 0; p < hosts[h]->peerCount; p++)
+			enet_peer_disconnect_now(&hosts[h]->peers[p], 0);
+		enet_host_destroy(hosts[h]);
+	}
+
+	for (int t = 0; t < Config.Threads; t++)
+	{
+		free(threads[t].Hosts);
+		free(threads[t].Delayed);
+	}
+	free(threads);
+	free(hosts);
+	free(Rooms);
+	free(Bots);
+	enet_deinitialize();
+
+	return 0;
+}
@@ -0,0 +1,39 @@
+
+baseName = path.getbasename(os.getcwd());
+
+project (baseName)
+    kind "ConsoleApp"
+    location "../_build"
+    targetdir "../_bin/%{cfg.buildcfg}"
+
+    filter "action:vs*"
+        defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
+        characterset ("MBCS")
+        debugdir "$(SolutionDir)"
+
+    filter "system:windows"
+        defines{"_WIN32"}
+        links {"winmm", "kernel32"}
+        libdirs {"../_bin/%{cfg.buildcfg}"}
+
+    filter "system:linux"
+        links {"pthread", "m", "dl", "rt"}
+
+    filter "system:macosx"
+        links {"CoreFoundation.framework"}
+
+    filter{}
+
+    vpaths
+    {
+        ["Header Files/*"] = { "include/**.h",  "include/**.hpp", "src/**.h", "src/**.hpp", "**.h", "**.hpp"},
+        ["Source Files/*"] = {"src/**.c", "src/**.cpp","**.c", "**.cpp"},
+    }
+    files {"**.c", "**.cpp", "**.h", "**.hpp"}
+
+    includedirs { "./" }
+    includedirs { "src" }
+    includedirs { "include" }
+
+    link_to("networking")
+    include_raylib()
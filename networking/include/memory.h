@@ -1,32 +1,145 @@
-//==========================================================================
-// Mouse Injector for Dolphin
-//==========================================================================
-// Copyright (C) 2019 Carnivorous
-// All rights reserved.
-//
-// Mouse Injector is free software; you can redistribute it and/or modify it
-// under the terms of the GNU General Public License as published by the Free
-// Software Foundation; either version 2 of the License, or (at your option)
-// any later version.
-//
-// This program is distributed in the hope that it will be useful, but
-// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
-// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
-// for more details.
-//
-// You should have received a copy of the GNU General Public License
-// along with this program; if not, visit http://www.gnu.org/licenses/gpl-2.0.html
-//==========================================================================
-#define NOTWITHINMEMRANGE(X) (X < 0x80000000 || X > 0x81800000) // if X is not within GC memory range
-#define WITHINMEMRANGE(X) (!NOTWITHINMEMRANGE(X)) // if X is within GC memory range
-extern uint8_t off;
-extern uint8_t MEM_Init(void);
-extern void MEM_Quit(void);
-extern void MEM_UpdateEmuoffset(void);
-extern int32_t MEM_ReadInt(const uint32_t addr);
-extern float MEM_ReadFloat(const uint32_t addr);
-extern void MEM_WriteInt(const uint32_t addr, uint32_t value);
-extern void MEM_PatchWord(const uint32_t addr, uint32_t value);
-extern void MEM_WriteFloat(const uint32_t addr, float value);
-extern void MEM_WriteByte(const uint32_t addr, uint8_t value);
-extern uint8_t MEM_ReadByte(const uint32_t addr);
\ No newline at end of file
+//==========================================================================
+// Mouse Injector for Dolphin
+//==========================================================================
+// Copyright (C) 2019 Carnivorous
+// All rights reserved.
+//
+// Mouse Injector is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, visit http://www.gnu.org/licenses/gpl-2.0.html
+//==========================================================================
+#pragma once
+
+#include <stdint.h>
+
+#define NOTWITHINMEMRANGE(X) (X < 0x80000000 || X > 0x81800000) // if X is not within GC memory range
+#define WITHINMEMRANGE(X) (!NOTWITHINMEMRANGE(X)) // if X is within GC memory range
+
+// the shared memory segment a cooperating emulator keeps the Model 3 RAM in, for the shm backend
+// emulated address 0 is the start of the segment, values are in the same byte order the emulator keeps them
+#if defined(_WIN32)
+#define MEM_SHM_NAME "Local\\scudplus_ram"
+#else
+#define MEM_SHM_NAME "/scudplus_ram"
+#endif
+#define MEM_SHM_SIZE 0x800000
+extern uint8_t off;
+
+// one run of bytes to write into the emulator
+typedef struct
+{
+	uint32_t Addr;
+	const void* Data;
+	uint32_t Size;
+}MEM_Span;
+
+// one run of bytes to read out of the emulator
+typedef struct
+{
+	uint32_t Addr;
+	void* Data;
+	uint32_t Size;
+}MEM_ReadSpan;
+
+//==========================================================================
+// A way of reaching the emulated RAM, addresses are emulated addresses.
+// The backend is picked once at startup (memory.c), everything below goes
+// through it.
+//==========================================================================
+typedef struct
+{
+	const char* Name;
+
+	// find the emulator and get ready to read and write, returns 1 on success
+	uint8_t (*Attach)(void);
+	void (*Detach)(void);
+
+	// look up where the emulator keeps its RAM again, it moves when the emulator restarts
+	void (*Refresh)(void);
+
+	// returns 1 when every byte was read
+	uint8_t (*Read)(uint32_t addr, void* buffer, uint32_t size);
+	void (*Write)(uint32_t addr, const void* data, uint32_t size);
+
+	// gather and scatter, in as few calls as the platform allows
+	uint8_t (*ReadSpans)(const MEM_ReadSpan* spans, uint32_t count);
+	void (*WriteSpans)(const MEM_Span* spans, uint32_t count);
+}MEM_Backend;
+
+#if defined(_WIN32)
+extern const MEM_Backend MEM_Win32Backend;   // ReadProcessMemory/WriteProcessMemory (memory_win32.c)
+#endif
+#if defined(__linux__)
+extern const MEM_Backend MEM_LinuxBackend;   // process_vm_readv/process_vm_writev (memory_linux.c)
+#endif
+extern const MEM_Backend MEM_ShmBackend;     // the RAM a cooperating emulator shares (memory_shm.c)
+extern const MEM_Backend MEM_ArrayBackend;   // a byte array in this process, for tools and benchmarks (memory_array.c)
+
+// every backend built for this platform, ends with NULL
+extern const MEM_Backend* const MEM_Backends[];
+
+// find a backend by name, NULL if there is no such backend on this platform
+extern const MEM_Backend* MEM_FindBackend(const char* name);
+
+// pick the backend MEM_Init attaches with, only before MEM_Init
+extern void MEM_SetBackend(const MEM_Backend* backend);
+extern const MEM_Backend* MEM_GetBackend(void);
+
+//==========================================================================
+// The order the emulator keeps the Model 3's 32 bit words in. Supermodel
+// keeps them in the host's order, which is what the addresses and patches
+// in scudplus.h are written for. An emulator that keeps the PowerPC's big
+// endian bytes as they are needs MEM_RamBigEndian: words are swapped on the
+// way in and out, bytes are where they are.
+// Ints, floats and patches are converted by the calls below, blocks and
+// spans come back as the RAM keeps them, use MEM_RamWord on the words in them.
+//==========================================================================
+typedef enum
+{
+	MEM_RamHostOrder,
+	MEM_RamBigEndian,
+}MEM_RamOrder;
+
+// pick the order, only before MEM_Init, SCUD_RAM_ORDER (host or big) picks it otherwise
+extern void MEM_SetRamOrder(MEM_RamOrder order);
+extern MEM_RamOrder MEM_GetRamOrder(void);
+
+// a word from the RAM in the host's order, or a word for the RAM in the RAM's order, it's the same swap both ways
+extern uint32_t MEM_RamWord(uint32_t word);
+
+extern uint8_t MEM_Init(void);
+extern void MEM_Quit(void);
+extern void MEM_UpdateEmuoffset(void);
+extern int32_t MEM_ReadInt(const uint32_t addr);
+extern float MEM_ReadFloat(const uint32_t addr);
+extern void MEM_WriteInt(const uint32_t addr, uint32_t value);
+extern void MEM_PatchWord(const uint32_t addr, uint32_t value);
+extern void MEM_WriteFloat(const uint32_t addr, float value);
+extern void MEM_WriteByte(const uint32_t addr, uint8_t value);
+extern uint8_t MEM_ReadByte(const uint32_t addr);
+extern uint8_t MEM_ReadBlock(const uint32_t addr, void* buffer, uint32_t size);
+
+// read a list of spans, returns 1 when all of them were read, on failure every span is zeroed
+extern uint8_t MEM_ReadSpans(const MEM_ReadSpan* spans, uint32_t count);
+
+// write a list of spans, in as few calls as the platform allows
+extern void MEM_WriteSpans(const MEM_Span* spans, uint32_t count);
+
+// batched writes, nothing is written until MEM_BatchFlush (memory_batch.c)
+// a value that is the same as the last one written to its address is skipped, only use these for fields the game doesn't change
+extern void MEM_BatchWriteInt(const uint32_t addr, uint32_t value);
+extern void MEM_BatchWriteFloat(const uint32_t addr, float value);
+extern void MEM_BatchWriteByte(const uint32_t addr, uint8_t value);
+// written on every flush, for values the game keeps changing and we keep setting back
+extern void MEM_BatchWriteIntAlways(const uint32_t addr, uint32_t value);
+extern void MEM_BatchWriteByteAlways(const uint32_t addr, uint8_t value);
+extern void MEM_BatchFlush(void);
@@ -0,0 +1,57 @@
+// several messages in one packet
+// every packet costs enet, UDP and IP headers and a system call, which is far more than the 2 to 20 bytes of most
+// of our messages. a batch collects the messages for one peer and sends them as one packet, a Batch message:
+//   the Batch command, then for every message a 1 byte length and the message itself (its own command first)
+// a batch with only one message in it is sent as that message on its own, without the framing.
+// the batch is written straight into the enet packet it is sent in (BeginPacket), so the messages are only copied once.
+#pragma once
+
+#include "net_common.h"
+
+#include <stdbool.h>
+
+// the most bytes a batch holds, well under the enet MTU so a batch never has to be split into fragments
+#define BATCH_CAPACITY 512
+
+// the biggest message that fits in a batch, the length is one byte
+#define BATCH_MESSAGE_MAX 255
+
+// messages waiting to be sent to one peer, a zeroed batch is empty
+typedef struct
+{
+	// the packet the Batch command and every message with its length are written into, no packet while the batch is empty
+	PacketWriter Writer;
+
+	// how many messages are in the packet
+	int Count;
+}MessageBatch;
+
+/// <summary>
+/// Empty a batch, nothing in it is sent and its packet is destroyed
+/// </summary>
+void BatchClear(MessageBatch* batch);
+
+/// <summary>
+/// Add a message to a batch
+/// </summary>
+/// <param name="batch">The batch to add to</param>
+/// <param name="message">The message, starting with its command</param>
+/// <param name="size">How many bytes the message is, 1 to BATCH_MESSAGE_MAX</param>
+/// <param name="flags">The enet packet flags, such as ENET_PACKET_FLAG_RELIABLE, used when the message starts a new packet</param>
+/// <returns>False if the message doesn't fit, the batch should be sent and the message added again</returns>
+bool BatchAppend(MessageBatch* batch, const uint8_t* message, size_t size, enet_uint32 flags);
+
+/// <summary>
+/// Finish the packet of a batch and empty it
+/// </summary>
+/// <param name="batch">The batch to send</param>
+/// <returns>The packet, ready for enet_peer_send, or NULL if the batch was empty</returns>
+ENetPacket* BatchEnd(MessageBatch* batch);
+
+/// <summary>
+/// Step through the messages in a packet, a Batch gives every message in it, anything else is one message
+/// </summary>
+/// <param name="reader">The packet, BeginRead it first and pass the same reader every time</param>
+/// <param name="message">Set up to read the next message from its command</param>
+/// <returns>False when there are no more messages, or the rest of the batch is cut short</returns>
+bool BatchNext(PacketReader* reader, PacketReader* message);
@@ -0,0 +1,174 @@
+// bit level packing for compact messages
+// values are written with as many bits as they need instead of whole bytes. bits go in lowest first, starting from the
+// lowest bit of the first byte, so a stream of whole bytes reads back the same way it would byte by byte.
+//
+// neither side checks bounds on every value. the writer checks when it empties its 64 bit scratch into the buffer,
+// the reader reads zeros past the end of the data, and the caller checks the Overflow flag once when the message is done.
+// BitReadStruct goes one further and checks for a whole struct's worth of bits before it decodes anything.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// A stream of bits being written into a buffer
+typedef struct
+{
+	uint8_t* Data;
+	size_t Capacity;
+
+	// how many whole bytes have been moved from the scratch to the buffer
+	size_t Offset;
+
+	// bits waiting to go into the buffer, lowest first
+	uint64_t Scratch;
+	int ScratchBits;
+
+	// set if the stream did not fit, the buffer should not be used
+	bool Overflow;
+}BitWriter;
+
+// A stream of bits being read from a buffer
+typedef struct
+{
+	const uint8_t* Data;
+	size_t Length;
+
+	// the next byte to load into the scratch, counts on past the end of the data (those bytes read as 0)
+	size_t Next;
+
+	// bits loaded but not read yet, lowest first
+	uint64_t Scratch;
+	int ScratchBits;
+
+	// set by BitReaderOverflow and BitReadStruct once a read has gone past the end
+	bool Overflow;
+}BitReader;
+
+// what kind of value a struct member is packed as
+typedef enum
+{
+	// an unsigned integer member in Bits bits
+	BitFieldUInt,
+
+	// any integer member, 1 bit, anything but 0 is sent as 1
+	BitFieldBool,
+
+	// an unsigned integer member as a varint, 8 bits for values under 128, up to 40 bits
+	BitFieldVarint,
+
+	// a signed integer member as a zig-zag varint, so small negative numbers are small too
+	BitFieldZigZag,
+
+	// a float member as fixed point from Min to Max in Bits bits, clamped to the range
+	BitFieldRangedFloat,
+
+	// a float angle in radians in Bits bits a turn, wraps instead of clamping and comes back in -PI..PI
+	BitFieldAngle,
+}BitFieldKind;
+
+// how one member of a struct is packed
+typedef struct
+{
+	BitFieldKind Kind;
+
+	// where the member is in the struct (offsetof) and how big it is, integers can be 1, 2 or 4 bytes
+	uint16_t Offset;
+	uint8_t Size;
+
+	// bits on the wire, for varints the fewest bits they can take
+	uint8_t Bits;
+
+	// the range of a BitFieldRangedFloat
+	float Min;
+	float Max;
+}BitField;
+
+// the fewest bits a varint takes, one group of 7 bits and the flag for more
+#define BIT_VARINT_MIN_BITS 8
+
+/// <summary>
+/// Start writing bits into a buffer
+/// </summary>
+/// <param name="writer">The writer to set up</param>
+/// <param name="data">The buffer to write into</param>
+/// <param name="capacity">How many bytes the buffer has room for</param>
+void BitWriterInit(BitWriter* writer, uint8_t* data, size_t capacity);
+
+/// <summary>
+/// Finish writing, the last partial byte is padded with zeros
+/// </summary>
+/// <returns>How many bytes were written, 0 if the stream overflowed</returns>
+size_t BitWriterFinish(BitWriter* writer);
+
+/// <summary>
+/// Write the low bits of a value
+/// </summary>
+/// <param name="writer">The writer to write to</param>
+/// <param name="value">The value, anything above the low bits is ignored</param>
+/// <param name="bits">How many bits to write, 0 to 32</param>
+void BitWriteBits(BitWriter* writer, uint32_t value, int bits);
+
+void BitWriteBool(BitWriter* writer, bool value);
+void BitWriteVarint(BitWriter* writer, uint32_t value);
+void BitWriteZigZag(BitWriter* writer, int32_t value);
+void BitWriteRangedFloat(BitWriter* writer, float value, float min, float max, int bits);
+void BitWriteAngle(BitWriter* writer, float angle, int bits);
+
+/// <summary>
+/// Start reading bits from a buffer
+/// </summary>
+/// <param name="reader">The reader to set up</param>
+/// <param name="data">The data to read</param>
+/// <param name="length">How many bytes of data there are</param>
+void BitReaderInit(BitReader* reader, const uint8_t* data, size_t length);
+
+/// <summary>
+/// Check whether any read so far went past the end of the data, the one bounds check a message needs
+/// </summary>
+/// <returns>True if the reads ran out of data, everything read after that is 0</returns>
+bool BitReaderOverflow(BitReader* reader);
+
+/// <summary>
+/// How many bits have been read so far
+/// </summary>
+size_t BitReaderPosition(const BitReader* reader);
+
+/// <summary>
+/// Read a value written by BitWriteBits
+/// </summary>
+/// <param name="reader">The reader to read from</param>
+/// <param name="bits">How many bits to read, 0 to 32</param>
+/// <returns>The value, 0 for any bits past the end of the data</returns>
+uint32_t BitReadBits(BitReader* reader, int bits);
+
+bool BitReadBool(BitReader* reader);
+uint32_t BitReadVarint(BitReader* reader);
+int32_t BitReadZigZag(BitReader* reader);
+float BitReadRangedFloat(BitReader* reader, float min, float max, int bits);
+float BitReadAngle(BitReader* reader, int bits);
+
+/// <summary>
+/// Write the members of a struct one after the other, as laid out in a field table
+/// </summary>
+/// <param name="writer">The writer to write to</param>
+/// <param name="fields">How every member is packed, in the order they go on the wire</param>
+/// <param name="count">How many fields there are</param>
+/// <param name="source">The struct to write</param>
+void BitWriteStruct(BitWriter* writer, const BitField* fields, int count, const void* source);
+
+/// <summary>
+/// Read the members of a struct written by BitWriteStruct with the same field table
+/// The data is checked once to hold the smallest the struct can be, a short message is caught before anything is decoded
+/// </summary>
+/// <param name="reader">The reader to read from</param>
+/// <param name="fields">How every member is packed</param>
+/// <param name="count">How many fields there are</param>
+/// <param name="dest">The struct to read into, members that are not in the table are left alone</param>
+/// <returns>False if the data is too short, dest is left alone if the check up front fails</returns>
+bool BitReadStruct(BitReader* reader, const BitField* fields, int count, void* dest);
+
+/// <summary>
+/// The most bits a struct can take with a field table
+/// </summary>
+size_t BitStructMaxBits(const BitField* fields, int count);
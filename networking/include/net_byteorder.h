@@ -0,0 +1,39 @@
+// byte order for the wire and the emulated RAM
+// everything on the wire is little endian, so x64 and ARM64 (the platforms we build for) send and read values as they
+// are and only a big endian machine pays for a swap. the bitstream is already the same on every machine, it is
+// defined in bytes.
+// the swaps compile to the processor's single byte swap instruction, so converting a field costs next to nothing.
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#define ByteSwap16(x) ((uint16_t)_byteswap_ushort((uint16_t)(x)))
+#define ByteSwap32(x) ((uint32_t)_byteswap_ulong((uint32_t)(x)))
+#else
+#define ByteSwap16(x) ((uint16_t)__builtin_bswap16((uint16_t)(x)))
+#define ByteSwap32(x) ((uint32_t)__builtin_bswap32((uint32_t)(x)))
+#endif
+
+// 1 when this machine is big endian
+#if defined(__BYTE_ORDER__)
+#define HOST_BIG_ENDIAN (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#elif defined(_WIN32)
+#define HOST_BIG_ENDIAN 0
+#else
+#error "can't tell the byte order of this platform, define HOST_BIG_ENDIAN"
+#endif
+
+// between the host's order and little endian (the wire), the same both ways
+#if HOST_BIG_ENDIAN
+#define LittleEndian16(x) ByteSwap16(x)
+#define LittleEndian32(x) ByteSwap32(x)
+#define BigEndian16(x) ((uint16_t)(x))
+#define BigEndian32(x) ((uint32_t)(x))
+#else
+#define LittleEndian16(x) ((uint16_t)(x))
+#define LittleEndian32(x) ((uint32_t)(x))
+#define BigEndian16(x) ByteSwap16(x)
+#define BigEndian32(x) ByteSwap32(x)
+#endif
@@ -0,0 +1,106 @@
+// quantized car state for the wire
+// a car is sent as fixed point numbers packed into as few bits as the game needs, instead of six floats and three bytes.
+// the state is split in two, the motion that changes every frame and the identity that almost never does,
+// so a moving car costs CAR_MOTION_SIZE bytes and the identity is only sent when it changes.
+//
+// error budget, the most a value that is in range can be off after a trip over the wire
+//   X, Z       +-4096 units, 18 bits, step 1/32, off by at most 1/64 (0.016)
+//   Y          +-128 units, 12 bits, step 1/16, off by at most 1/32 (0.031)
+//   Yaw        any angle in radians, 12 bits a turn, off by at most 0.00077 rad (0.044 degrees), comes back in -PI..PI
+//   Pitch      +-PI/4 radians, 10 bits, the same step as yaw
+//   Speed      0 to 511.5, 10 bits, step 0.5, off by at most 0.25
+//   BrakeLight 1 bit, any value but 0 comes back as 1
+//   Car        3 bits, 0-7
+//   CarNumber  8 bits, exact
+// values outside their range are clamped to its ends, a car past the edge of the range sticks to the edge instead of
+// wrapping around to the other side. every value that is clamped is counted, see CarCodecClamps.
+//
+// what the ranges and the units are based on
+//   there are no RAM captures of the real courses in this tree. the only source of car states here is fakemodel, which
+//   drives an oval of 450 by 300 units (X -450..450, Z -300..300), Y -2..2, pitch -0.05..0.05, speed up to 432 and a
+//   yaw from atan2, so radians in -PI..PI. the client's dead reckoning wraps yaw at 2 PI (dead_reckoning.c), which is
+//   the same assumption.
+//   so the ranges and the radian angles are unconfirmed against the game. until they are checked on every course,
+//   watch the clamp counts: Position, Height, Pitch or Speed going up means a course goes past a range, and YawTurns
+//   going up means the game's yaw is more than a turn from 0, which radians from the game should never be (degrees or
+//   a raw binary angle would). if that happens, widen the range or change the unit and take the bits from elsewhere.
+#pragma once
+
+#include "net_snapshot.h"
+
+#include <stdint.h>
+
+// bytes on the wire for each part of a car
+#define CAR_MOTION_SIZE 10
+#define CAR_IDENTITY_SIZE 2
+
+// the error budget above, bench codec -check fails if a car in range comes back further off than this
+#define CAR_ERROR_XZ (1.0f / 64.0f)
+#define CAR_ERROR_Y (1.0f / 32.0f)
+#define CAR_ERROR_ANGLE 0.00077f
+#define CAR_ERROR_SPEED 0.25f
+
+// how many values were out of range when a car was packed, since the program started
+typedef struct
+{
+	// X or Z, clamped to +-4096
+	uint32_t Position;
+
+	// Y, clamped to +-128
+	uint32_t Height;
+
+	// clamped to +-PI/4
+	uint32_t Pitch;
+
+	// clamped to 0..511.5
+	uint32_t Speed;
+
+	// yaw more than a turn from 0, it is packed fine but it is a sign the game's yaw isn't in radians
+	uint32_t YawTurns;
+}CarCodecClamps;
+
+/// <summary>
+/// Get how many values the codec has clamped so far, every thread's cars are counted
+/// </summary>
+/// <param name="clamps">Filled in with the counts</param>
+void CarCodecGetClamps(CarCodecClamps* clamps);
+
+/// <summary>
+/// Pack the position, angles and speed of a car
+/// </summary>
+/// <param name="car">The car to pack</param>
+/// <param name="data">CAR_MOTION_SIZE bytes to pack into</param>
+void EncodeCarMotion(const CarState* car, uint8_t* data);
+
+/// <summary>
+/// Unpack the position, angles and speed of a car, the other fields are left alone
+/// </summary>
+/// <param name="data">CAR_MOTION_SIZE bytes packed by EncodeCarMotion</param>
+/// <param name="car">The car to unpack into</param>
+void DecodeCarMotion(const uint8_t* data, CarState* car);
+
+/// <summary>
+/// Pack the brake light, car and car number
+/// </summary>
+/// <param name="car">The car to pack</param>
+/// <param name="data">CAR_IDENTITY_SIZE bytes to pack into</param>
+void EncodeCarIdentity(const CarState* car, uint8_t* data);
+
+/// <summary>
+/// Unpack the brake light, car and car number, the other fields are left alone
+/// </summary>
+/// <param name="data">CAR_IDENTITY_SIZE bytes packed by EncodeCarIdentity</param>
+/// <param name="car">The car to unpack into</param>
+void DecodeCarIdentity(const uint8_t* data, CarState* car);
+
+/// <summary>
+/// Round a car to what comes out the other end of the wire
+/// </summary>
+/// <param name="car">The car to round, in place</param>
+void QuantizeCarState(CarState* car);
+
+// the same, straight into and out of a packet
+void PacketWriteCarMotion(PacketWriter* writer, const CarState* car);
+void PacketWriteCarIdentity(PacketWriter* writer, const CarState* car);
+void PacketReadCarMotion(PacketReader* reader, CarState* car);
+void PacketReadCarIdentity(PacketReader* reader, CarState* car);
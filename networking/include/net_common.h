@@ -40,24 +40,99 @@
 // include the network layer from enet (https://github.com/zpl-c/enet)
 #include "enet.h"
 
-// Utility functions to read data out of a packet
+#include <stdbool.h>
+
+// Packet writer and reader
+// The writer creates the enet packet first and packs the data straight into it, so a message never has to be built in a
+// buffer and copied. The reader keeps track of its own position in a packet and never reads past the end of it.
+
+// A packet being written
+typedef struct
+{
+	// the packet we are writing into
+	ENetPacket* Packet;
+
+	// how many bytes have been written so far
+	size_t Offset;
+
+	// how many bytes the packet has room for
+	size_t Capacity;
+
+	// set if a write did not fit, the packet should not be sent
+	bool Overflow;
+}PacketWriter;
+
+// A packet being read
+typedef struct
+{
+	const uint8_t* Data;
+	size_t Length;
+
+	// how many bytes have been read so far
+	size_t Offset;
+
+	// set if a read went past the end of the data, everything read after that is 0
+	bool Overflow;
+}PacketReader;
+
+/// <summary>
+/// Create a packet and start writing into it
+/// </summary>
+/// <param name="writer">The writer to set up</param>
+/// <param name="capacity">The most bytes the message can use</param>
+/// <param name="flags">The enet packet flags, such as ENET_PACKET_FLAG_RELIABLE</param>
+/// <returns>False if the packet could not be created</returns>
+bool BeginPacket(PacketWriter* writer, size_t capacity, enet_uint32 flags);
+
+/// <summary>
+/// Finish writing a packet, the packet length is trimmed to what was written
+/// </summary>
+/// <param name="writer">The writer to finish</param>
+/// <returns>The packet, ready for enet_peer_send, or NULL if a write overflowed (the packet is destroyed)</returns>
+ENetPacket* EndPacket(PacketWriter* writer);
+
+void PacketWriteByte(PacketWriter* writer, uint8_t value);
+void PacketWriteShort(PacketWriter* writer, int16_t value);
+void PacketWriteUInt(PacketWriter* writer, uint32_t value);
+void PacketWriteFloat(PacketWriter* writer, float value);
+
+/// <summary>
+/// Reserve space in the packet to fill in directly
+/// </summary>
+/// <param name="writer">The writer to reserve space in</param>
+/// <param name="size">How many bytes to reserve</param>
+/// <returns>A pointer to the reserved bytes, or NULL if they don't fit</returns>
+uint8_t* PacketWriteSpan(PacketWriter* writer, size_t size);
 
 /// <summary>
-/// Read one byte out of a packet, from an offset, and update that offset to the next location to read from
+/// Start reading a packet from the beginning
 /// </summary>
-/// <param name="packet">The packet to read from</param>
-/// <param name="offset">A pointer to an offset that is updated, this should be passed to other read functions so they read from the correct place</param>
-/// <returns>The byte read</returns>
-uint8_t ReadByte(ENetPacket* packet, size_t* offset);
+/// <param name="reader">The reader to set up</param>
+/// <param name="packet">The packet to read</param>
+void BeginRead(PacketReader* reader, ENetPacket* packet);
 
 /// <summary>
-/// Read a signed short from the network packet
-/// Note that this assumes the packet is in the host's byte ordering
-/// In reality read/write code should use ntohs and htons to convert from network byte order to host byte order, so both big endian and little endian machines can play together
+/// Get the next bytes to read and move past them
 /// </summary>
-/// <param name="packet">The packet to read from<</param>
-/// <param name="offset">A pointer to an offset that is updated, this should be passed to other read functions so they read from the correct place</param>
-/// <returns>The signed short that is read</returns>
-int16_t ReadShort(ENetPacket* packet, size_t* offset);
+/// <param name="reader">The reader to read from</param>
+/// <param name="size">How many bytes to read</param>
+/// <returns>A pointer to the bytes in the packet, or NULL if there are not enough bytes left</returns>
+const uint8_t* PacketReadSpan(PacketReader* reader, size_t size);
 
-float ReadFloat(ENetPacket* packet, size_t* offset);
\ No newline at end of file
+uint8_t PacketReadByte(PacketReader* reader);
+int16_t PacketReadShort(PacketReader* reader);
+uint32_t PacketReadUInt(PacketReader* reader);
+float PacketReadFloat(PacketReader* reader);
+
+/// <summary>
+/// Check that there are at least some bytes left to read
+/// </summary>
+/// <returns>True if there are size bytes left</returns>
+bool PacketCanRead(const PacketReader* reader, size_t size);
+
+/// <summary>
+/// The time in microseconds from a clock that never goes backwards
+/// Every process on a machine reads the same clock, so times can be compared between a client and a server on loopback
+/// </summary>
+/// <returns>Microseconds since some fixed point in the past</returns>
+uint64_t NetTimeMicros(void);
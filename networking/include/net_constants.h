@@ -32,6 +32,23 @@
 #define MAX_PLAYERS 8
 
 #define MAX_PLAYERS 8
+
+// the enet channels every connection uses
+// lifecycle commands (accept, add, remove, ready, race start) go on a reliable channel so they always arrive and arrive in order.
+// car state goes on an unreliable channel, enet drops any update that shows up after a newer one, so a lost packet never holds up the ones behind it.
+#define CHANNEL_CONTROL 0
+#define CHANNEL_STATE 1
+#define CHANNEL_COUNT 2
+
+// the data a client sends with its connection request is how many players it wants in its race in the low byte
+// 0 (what the game client sends) means a full race of MAX_PLAYERS, the load generator asks for smaller ones
+#define ROOM_SIZE_DEFAULT 0
+#define ROOM_SIZE_MASK 0xFF
+
+// set in the connection data by clients that measure latency, their world snapshots also carry when every car's
+// position was sent and how long the server held it
+#define CONNECT_WANTS_TIMING 0x100
+
 // how big the screen is for all players
 #define FieldSizeWidth 1
 #define FieldSizeHeight  1
@@ -48,10 +65,11 @@ typedef enum
 	// Server -> Client, Remove a player from your simulation, contains the ID of the player to remove
 	RemovePlayer = 3,
 
-	// Server -> Client, Update a player's position in the simulation, contains the ID of the player and a position
+	// reserved, this was the server relaying one player's position, every position now goes out once per tick in UpdateWorld
+	// kept so the number isn't used again for something else, it has no message in net_messages.h
 	UpdatePlayer = 4,
 
-	// Client -> Server, Provide an updated location for the client's player, contains the postion to update
+	// Client -> Server, Provide an updated location for the client's player, contains the postion to update and the time (NetTimeMicros) it was sent
 	UpdateInput = 5,
 
 	// Client -> Server, tells server that this player is ready. 
@@ -62,4 +80,13 @@ typedef enum
 
 	// Server -> Client, everyone is ready so when can start the race.
 	RaceStart = 8,
+
+	// Server -> Client, one server tick worth of world state, contains the tick number, the tick it was delta encoded against and the changed state of every valid player
+	UpdateWorld = 9,
+
+	// Client -> Server, the newest world snapshot the client has received, the server encodes the next snapshots against it
+	AckWorld = 10,
+
+	// Either way, several of the other messages in one packet, each with its length in front (net_batch.h)
+	Batch = 11,
 }NetworkCommands;
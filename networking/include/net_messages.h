@@ -0,0 +1,76 @@
+// the layout of every network message, written down once
+// NET_MESSAGES below is the schema, every message is its command and its fields in the order they go on the wire.
+// everything else, the message structs, their sizes and the functions that pack and unpack them, is generated from it
+// by the preprocessor, so the sender and the receiver of a message can't disagree about where a field is.
+//
+// every message starts with its 1 byte command, the fields follow with no padding. a message is always the same size,
+// UpdateWorld is the exception, the schema only has its header and the car deltas follow it (net_snapshot.h).
+//
+// to add a field, add it to the message in NET_MESSAGES and fill it in where the message is sent.
+#pragma once
+
+#include "net_common.h"
+#include "net_car_codec.h"
+
+#include <stdbool.h>
+
+// the field types, the C type a field has in its message struct and how many bytes it takes on the wire
+// a new type also needs a Store and a Load in net_messages.c
+#define NET_TYPE_Byte uint8_t
+#define NET_TYPE_UInt uint32_t
+#define NET_TYPE_Car CarState
+
+#define NET_SIZE_Byte 1
+#define NET_SIZE_UInt 4
+
+// a car is the motion and the identity from net_car_codec.h, not the timing
+#define NET_SIZE_Car (CAR_MOTION_SIZE + CAR_IDENTITY_SIZE)
+
+// MESSAGE(command, fields) for every message, fields is a list of FIELD(type, name)
+#define NET_MESSAGES(MESSAGE, FIELD) \
+	MESSAGE(AcceptPlayer,	FIELD(Byte, PlayerId)) \
+	MESSAGE(AddPlayer,		FIELD(Byte, PlayerId)) \
+	MESSAGE(RemovePlayer,	FIELD(Byte, PlayerId)) \
+	MESSAGE(UpdateInput,	FIELD(Car, Car) FIELD(UInt, SampleTime)) \
+	MESSAGE(PlayerIsReady,	) \
+	MESSAGE(MasterIsReady,	FIELD(Byte, PlayerId)) \
+	MESSAGE(RaceStart,		FIELD(Byte, PlayerId)) \
+	MESSAGE(UpdateWorld,	FIELD(UInt, Tick) FIELD(UInt, BaseTick) FIELD(Byte, Present)) \
+	MESSAGE(AckWorld,		FIELD(UInt, Tick))
+
+// the message structs, AcceptPlayerMessage and so on
+// Command is filled in when a message is read, the writers always send the message's own command
+#define NET_STRUCT_FIELD(type, name) NET_TYPE_##type name;
+#define NET_STRUCT(command, fields) typedef struct { uint8_t Command; fields } command##Message;
+NET_MESSAGES(NET_STRUCT, NET_STRUCT_FIELD)
+#undef NET_STRUCT
+#undef NET_STRUCT_FIELD
+
+// the size of every message on the wire, command included, AcceptPlayerMessageSize and so on
+#define NET_SIZE_FIELD(type, name) + NET_SIZE_##type
+#define NET_SIZE(command, fields) command##MessageSize = 1 fields,
+enum
+{
+	NET_MESSAGES(NET_SIZE, NET_SIZE_FIELD)
+};
+#undef NET_SIZE
+#undef NET_SIZE_FIELD
+
+// for a MESSAGE that doesn't need the fields
+#define NET_IGNORE_FIELD(type, name)
+
+// for every message
+//   Encode<command>        pack a message into <command>MessageSize bytes
+//   Decode<command>        unpack a message from <command>MessageSize bytes
+//   PacketWrite<command>   pack a message into a packet, false if it doesn't fit
+//   PacketRead<command>    unpack a message from a packet, false if the packet is too short or is a different command,
+//                          the message is left alone then
+//   Create<command>Packet  create a packet that holds just the message, NULL if it could not be created
+#define NET_FUNCTIONS(command, fields) \
+	void Encode##command(const command##Message* message, uint8_t* data); \
+	void Decode##command(const uint8_t* data, command##Message* message); \
+	bool PacketWrite##command(PacketWriter* writer, const command##Message* message); \
+	bool PacketRead##command(PacketReader* reader, command##Message* message); \
+	ENetPacket* Create##command##Packet(const command##Message* message, enet_uint32 flags);
+NET_MESSAGES(NET_FUNCTIONS, NET_IGNORE_FIELD)
+#undef NET_FUNCTIONS
@@ -0,0 +1,64 @@
+// a pool allocator for enet
+// enet mallocs a packet and a command node for every message it sends or receives, and frees them again once they are
+// acknowledged or handled. The pool keeps those blocks on free lists sorted by size so they can be handed straight back out.
+// Every thread has its own free lists, so there are no locks, and a block freed on one thread is simply reused by that thread.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// the block sizes the pool keeps, anything bigger goes straight to malloc
+#define POOL_CLASS_COUNT 6
+#define POOL_MAX_BLOCK 2048
+
+// how many free blocks of each size a thread keeps before it gives them back to the system
+#define POOL_MAX_FREE 4096
+
+// how the pool has been used by one thread
+typedef struct
+{
+	// allocations handed a block off a free list
+	uint64_t Hits;
+
+	// allocations that had to go to malloc because the free list was empty
+	uint64_t Misses;
+
+	// allocations too big for any size class
+	uint64_t Large;
+
+	// blocks that were given back to the system instead of kept
+	uint64_t Released;
+
+	// blocks on the free lists right now
+	uint64_t Cached;
+}NetPoolStats;
+
+/// <summary>
+/// Set up enet with the pool as its allocator, use this instead of enet_initialize
+/// </summary>
+/// <returns>0 on success, like enet_initialize</returns>
+int NetPoolInitialize(void);
+
+/// <summary>
+/// Get a block from the calling thread's pool
+/// </summary>
+/// <param name="size">How many bytes are needed</param>
+/// <returns>The block, or NULL if the system is out of memory</returns>
+void* NetPoolAlloc(size_t size);
+
+/// <summary>
+/// Give a block back to the calling thread's pool, it does not have to be the thread that allocated it
+/// </summary>
+/// <param name="memory">A block from NetPoolAlloc, or NULL</param>
+void NetPoolFree(void* memory);
+
+/// <summary>
+/// Get the counters for the calling thread
+/// </summary>
+/// <param name="stats">Filled in with the counters</param>
+void NetPoolGetStats(NetPoolStats* stats);
+
+/// <summary>
+/// Give every free block the calling thread is keeping back to the system, call it before the thread exits
+/// </summary>
+void NetPoolReleaseThread(void);
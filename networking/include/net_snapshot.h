@@ -0,0 +1,140 @@
+// world snapshots shared by the client and the server
+// the server keeps a short history of what the world looked like every tick, and sends each client only what changed
+// since the last snapshot that client told us it received. The client keeps the same history so it can rebuild the full world.
+#pragma once
+
+#include "net_common.h"
+
+#include <stdbool.h>
+
+// how many ticks of history we keep, a client that has not acknowledged anything this recent gets a full snapshot
+// must be a power of two
+#define SNAPSHOT_HISTORY 64
+
+// an UpdateWorld message starts with the header in net_messages.h, the tick, the baseline tick and the present mask
+// then has a field mask byte and the changed fields for each player
+
+// RelayDelay counts in steps of this many microseconds, so it can hold up to about 650ms
+#define SNAPSHOT_RELAY_UNIT 10
+
+// the state of one car that is sent over the network
+typedef struct
+{
+	float X;
+	float Y;
+	float Z;
+
+	float Pitch;
+	float Yaw;
+
+	float Speed;
+
+	uint8_t BrakeLight;
+	uint8_t Car;
+	uint8_t CarNumber;
+
+	// when the player sent this state, the low 32 bits of their NetTimeMicros
+	uint32_t SampleTime;
+
+	// how long the server held the state before the snapshot was taken, in units of SNAPSHOT_RELAY_UNIT microseconds
+	uint16_t RelayDelay;
+}CarState;
+
+// the parts of a CarState that are sent on their own, a delta only carries the parts whose bit is set
+// the motion and identity are packed by net_car_codec.h
+typedef enum
+{
+	// X, Y, Z, Pitch, Yaw and Speed
+	CarFieldMotion = 1 << 0,
+
+	// BrakeLight, Car and CarNumber
+	CarFieldIdentity = 1 << 1,
+
+	// SampleTime and RelayDelay, only sent to clients that asked for timing
+	CarFieldTiming = 1 << 2,
+
+	// every part that describes the car, a car the receiver has not seen before is sent with all of these
+	CarFieldAll = CarFieldMotion | CarFieldIdentity,
+}CarStateFields;
+
+// the state of every car for one server tick
+typedef struct
+{
+	// the server tick this snapshot was taken on, 0 for an unused slot
+	uint32_t Tick;
+
+	// one bit for every player id that is in the snapshot
+	uint8_t Present;
+
+	CarState Cars[MAX_PLAYERS];
+}WorldSnapshot;
+
+// a ring of the most recent snapshots
+typedef struct
+{
+	WorldSnapshot Snapshots[SNAPSHOT_HISTORY];
+}SnapshotHistory;
+
+/// <summary>
+/// Get the history slot for a tick, any older snapshot using the same slot is replaced
+/// </summary>
+/// <param name="history">The history to store into</param>
+/// <param name="tick">The tick the snapshot is for</param>
+/// <returns>The slot to fill in, its tick is already set</returns>
+WorldSnapshot* StoreSnapshot(SnapshotHistory* history, uint32_t tick);
+
+/// <summary>
+/// Find the snapshot for a tick
+/// </summary>
+/// <param name="history">The history to look in</param>
+/// <param name="tick">The tick to look for</param>
+/// <returns>The snapshot, or NULL if that tick is not in the history anymore</returns>
+const WorldSnapshot* FindSnapshot(const SnapshotHistory* history, uint32_t tick);
+
+/// <summary>
+/// Work out which parts of a car are different from a baseline
+/// </summary>
+/// <returns>A CarStateFields mask of the changed fields</returns>
+uint8_t GetCarChanges(const CarState* state, const CarState* baseline);
+
+// what one receiver is sent for a snapshot, worked out before the packet is created so it can be created at the right size
+typedef struct
+{
+	// the players in the message
+	uint8_t Present;
+
+	// the fields sent for each player
+	uint8_t Fields[MAX_PLAYERS];
+
+	// the size of the whole message
+	size_t Size;
+}SnapshotDelta;
+
+/// <summary>
+/// Work out what goes in an UpdateWorld message for a snapshot, only what changed since the baseline
+/// </summary>
+/// <param name="delta">Filled in with the fields to send and the message size</param>
+/// <param name="world">The snapshot to send</param>
+/// <param name="baseline">The last snapshot the receiver acknowledged, or NULL to send everything</param>
+/// <param name="exceptPlayerId">A player to leave out (usually the receiver, who knows where they are), or -1</param>
+/// <param name="withTiming">Send the timing of every car too</param>
+/// <returns>False if the receiver already has everything in the snapshot</returns>
+bool PrepareWorldSnapshot(SnapshotDelta* delta, const WorldSnapshot* world, const WorldSnapshot* baseline, int exceptPlayerId, bool withTiming);
+
+/// <summary>
+/// Pack an UpdateWorld message that was worked out by PrepareWorldSnapshot
+/// </summary>
+/// <param name="writer">The packet to write into, it needs room for delta->Size bytes</param>
+/// <param name="world">The snapshot to send</param>
+/// <param name="baseline">The same baseline given to PrepareWorldSnapshot</param>
+/// <param name="delta">The fields to send</param>
+void WriteWorldSnapshot(PacketWriter* writer, const WorldSnapshot* world, const WorldSnapshot* baseline, const SnapshotDelta* delta);
+
+/// <summary>
+/// Read an UpdateWorld message
+/// </summary>
+/// <param name="reader">The packet to read from, at the start of the message</param>
+/// <param name="history">The snapshots we have received so far, used to find the baseline</param>
+/// <param name="world">Filled in with the complete snapshot</param>
+/// <returns>False if the baseline is not in our history or the message is too short</returns>
+bool ReadWorldSnapshot(PacketReader* reader, const SnapshotHistory* history, WorldSnapshot* world);
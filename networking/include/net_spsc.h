@@ -0,0 +1,58 @@
+// a lock free queue between exactly two threads, one that pushes and one that pops
+// used to pass messages between the client's network thread and the game thread without either of them ever waiting on a lock
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// keep the two ends on their own cache lines, so the threads don't slow each other down writing next to each other
+#define SPSC_CACHE_LINE 64
+
+// a ring of fixed size items
+typedef struct
+{
+	uint8_t* Items;
+	uint32_t ItemSize;
+
+	// must be a power of two
+	uint32_t Capacity;
+
+	// the next item to pop, only the consumer writes this
+	uint8_t HeadPadding[SPSC_CACHE_LINE];
+	volatile uint32_t Head;
+
+	// the next free item, only the producer writes this
+	uint8_t TailPadding[SPSC_CACHE_LINE];
+	volatile uint32_t Tail;
+	uint8_t EndPadding[SPSC_CACHE_LINE];
+}SpscRing;
+
+/// <summary>
+/// Allocate the items for a ring, the ring must not be in use by any thread yet
+/// </summary>
+/// <param name="ring">The ring to set up</param>
+/// <param name="itemSize">The size of one item in bytes</param>
+/// <param name="capacity">How many items the ring can hold, must be a power of two</param>
+/// <returns>False if the memory could not be allocated or the capacity is not a power of two</returns>
+bool SpscInit(SpscRing* ring, uint32_t itemSize, uint32_t capacity);
+
+/// <summary>
+/// Free the items of a ring, neither thread can be using it anymore
+/// </summary>
+void SpscFree(SpscRing* ring);
+
+/// <summary>
+/// Add a copy of an item to the ring, only ever call this from the producer thread
+/// </summary>
+/// <param name="ring">The ring to add to</param>
+/// <param name="item">ItemSize bytes to copy in</param>
+/// <returns>False if the ring is full</returns>
+bool SpscPush(SpscRing* ring, const void* item);
+
+/// <summary>
+/// Take the oldest item out of the ring, only ever call this from the consumer thread
+/// </summary>
+/// <param name="ring">The ring to take from</param>
+/// <param name="item">Filled in with ItemSize bytes</param>
+/// <returns>False if the ring is empty</returns>
+bool SpscPop(SpscRing* ring, void* item);
@@ -0,0 +1,35 @@
+// a minimal thread wrapper so the server and client can run network work on other threads
+// uses win32 threads on windows and pthreads everywhere else
+#pragma once
+
+#include <stdbool.h>
+
+// the function a thread runs
+typedef void (*NetThreadFunction)(void* arg);
+
+// a running thread
+typedef struct
+{
+	void* Handle;
+}NetThread;
+
+/// <summary>
+/// Start a new thread
+/// </summary>
+/// <param name="thread">Filled in with the thread so it can be joined later</param>
+/// <param name="function">The function the thread runs</param>
+/// <param name="arg">Passed to the function</param>
+/// <returns>True if the thread was started</returns>
+bool StartThread(NetThread* thread, NetThreadFunction function, void* arg);
+
+/// <summary>
+/// Wait for a thread to finish and release it
+/// </summary>
+/// <param name="thread">The thread to wait for</param>
+void JoinThread(NetThread* thread);
+
+/// <summary>
+/// Put the calling thread to sleep
+/// </summary>
+/// <param name="milliseconds">How long to sleep for</param>
+void SleepThread(int milliseconds);
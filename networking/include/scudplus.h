@@ -33,6 +33,16 @@
 #define gRPArrows 0x10F030
 #define ENABLEARROWS 0xFF
 //--------------------
+// blocks that are read with one call a frame
+// the system block holds gPauseGame through gLink
+#define gSystemBlock 0x100000
+#define gSystemBlockSize 0x120
+// the state block holds gMainState through gCourse
+#define gStateBlock 0x104000
+#define gStateBlockSize 0xF48
+//--------------------
+// every car object is this big, pBase[n] is pBase[0] + n * CAR_STRIDE
+#define CAR_STRIDE 0x300
 #define bCanMove 0x00
 #define bCarType 0x06
 #define bCarOwner 0x07
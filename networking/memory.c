@@ -1,160 +1,229 @@
-
-#include <stdint.h>
-#include <windows.h>
-#include <tlhelp32.h>
-#include <psapi.h>
-#include "memory.h"
-
-#define EMU_PTR 0x432058
-
-static uint32_t emuoffset = 0;
-static HANDLE emuhandle = NULL;
-
-static uintptr_t modBaseAddr;
-
-uint8_t off = 0;
-
-
-uint8_t MEM_Init(void);
-void MEM_Quit(void);
-void MEM_UpdateEmuoffset(void);
-int32_t MEM_ReadInt(const uint32_t addr);
-float MEM_ReadFloat(const uint32_t addr);
-void MEM_WriteInt(const uint32_t addr, uint32_t value);
-void MEM_WriteFloat(const uint32_t addr, float value);
-
-
-DWORD GetProcId(const wchar_t* procName)
-{
-	DWORD procId = 0;
-	HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-	if (hSnap != INVALID_HANDLE_VALUE)
-	{
-		PROCESSENTRY32 procEntry;
-		procEntry.dwSize = sizeof(PROCESSENTRY32);
-
-		if (Process32First(hSnap, &procEntry))
-		{
-			do
-			{
-				if (!_wcsicmp(procEntry.szExeFile, procName))
-				{
-					procId = procEntry.th32ProcessID;
-					//std::cout << procId << std::endl;
-					break;
-				}
-			} while (Process32Next(hSnap, &procEntry));
-		}
-	}
-	CloseHandle(hSnap);
-
-	return procId;
-}
-
-uintptr_t GetModuleBaseAddress(DWORD procId, const wchar_t* modName)
-{
-	uintptr_t moduleBaseAddress = 0;
-	HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, procId);
-	if (hSnap != INVALID_HANDLE_VALUE)
-	{
-		MODULEENTRY32 moduleEntry;
-		moduleEntry.dwSize = sizeof(MODULEENTRY32);
-
-		if (Module32First(hSnap, &moduleEntry))
-		{
-			do
-			{
-				if (!_wcsicmp(moduleEntry.szModule, modName))
-				{
-					moduleBaseAddress = (uintptr_t)moduleEntry.modBaseAddr;
-					break;
-				}
-			} while (Module32Next(hSnap, &moduleEntry));
-		}
-	}
-	CloseHandle(hSnap);
-
-	return moduleBaseAddress;
-}
-
-
-//==========================================================================
-// Purpose: initialize dolphin handle and setup for memory injection
-// Changed Globals: emuhandle
-//==========================================================================
-uint8_t MEM_Init(void)
-{
-	const wchar_t gameName[] = L"Supermodel.exe";
-	emuhandle = NULL;
-	DWORD procID = GetProcId(gameName);
-	emuhandle = OpenProcess(PROCESS_ALL_ACCESS, NULL, procID);
-	modBaseAddr = GetModuleBaseAddress(procID, gameName);
-	return emuhandle != NULL ? 1 : 0;
-}
-//==========================================================================
-// Purpose: close emuhandle safely
-// Changed Globals: emuhandle
-//==========================================================================
-void MEM_Quit(void)
-{
-	if(emuhandle != NULL)
-		CloseHandle(emuhandle);
-}
-
-
-void MEM_UpdateEmuoffset(void)
-{
-	ReadProcessMemory(emuhandle, (LPVOID)(modBaseAddr + EMU_PTR), &emuoffset, sizeof(emuoffset), NULL);;
-}
-
-static void MEM_ByteSwap32(uint32_t* input)
-{
-	const uint8_t* inputarray = ((uint8_t*)input); // set byte array to input
-	*input = (uint32_t)((inputarray[0] << 24) | (inputarray[1] << 16) | (inputarray[2] << 8) | (inputarray[3])); // reassign input to swapped value
-}
-
-
-int32_t MEM_ReadInt(const uint32_t addr)
-{
-	int32_t output;
-	ReadProcessMemory(emuhandle, (LPVOID)(emuoffset + addr), &output, sizeof(output), NULL);
-	return output;
-}
-
-
-float MEM_ReadFloat(const uint32_t addr)
-{
-	float output;
-	ReadProcessMemory(emuhandle, (LPVOID)(emuoffset + addr), &output, sizeof(output), NULL);
-	return output;
-}
-
-
-void MEM_WriteInt(const uint32_t addr, uint32_t value)
-{
-	WriteProcessMemory(emuhandle, (LPVOID)(emuoffset + addr), &value, sizeof(value), NULL);
-}
-
-void MEM_PatchWord(const uint32_t addr, uint32_t value)
-{
-	//MEM_ByteSwap32(&value);
-	WriteProcessMemory(emuhandle, (LPVOID)(emuoffset + addr), &value, sizeof(value), NULL);
-}
-
-
-void MEM_WriteFloat(const uint32_t addr, float value)
-{
-	WriteProcessMemory(emuhandle, (LPVOID)(emuoffset + addr), &value, sizeof(value), NULL);
-}
-
-void MEM_WriteByte(const uint32_t addr, uint8_t value)
-{
-	WriteProcessMemory(emuhandle, (LPVOID)(emuoffset + addr), &value, sizeof(value), NULL);
-}
-
-uint8_t MEM_ReadByte(const uint32_t addr)
-{
-	uint8_t output;
-	ReadProcessMemory(emuhandle, (LPVOID)((emuoffset) + addr), &output, sizeof(output), NULL);
-	return output;
-}
+//==========================================================================
+// Emulator memory, every call goes through the backend picked at startup
+//==========================================================================
+// The backend is, in order:
+// - the one given to MEM_SetBackend before MEM_Init
+// - the one named by SCUD_MEMORY (win32, linux, shm or array)
+// - the one the project was generated for with --memory
+// - the first one built for this platform
+// The byte order of the RAM is the one given to MEM_SetRamOrder, or the one
+// named by SCUD_RAM_ORDER (host or big), or the host's.
+//==========================================================================
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+#include "net_byteorder.h"
+
+#if defined(MEM_BACKEND_WIN32)
+#define MEM_DEFAULT_BACKEND "win32"
+#elif defined(MEM_BACKEND_LINUX)
+#define MEM_DEFAULT_BACKEND "linux"
+#elif defined(MEM_BACKEND_SHM)
+#define MEM_DEFAULT_BACKEND "shm"
+#elif defined(MEM_BACKEND_ARRAY)
+#define MEM_DEFAULT_BACKEND "array"
+#endif
+
+const MEM_Backend* const MEM_Backends[] =
+{
+#if defined(_WIN32)
+	&MEM_Win32Backend,
+#endif
+#if defined(__linux__)
+	&MEM_LinuxBackend,
+#endif
+	&MEM_ShmBackend,
+	&MEM_ArrayBackend,
+	NULL
+};
+
+static const MEM_Backend* backend = NULL;
+static uint8_t attached = 0;
+
+static MEM_RamOrder ramOrder = MEM_RamHostOrder;
+static uint8_t ramOrderSet = 0;
+
+// words have to be swapped, the RAM is big endian and we are not
+static uint8_t ramSwapped = 0;
+
+uint8_t off = 0;
+
+const MEM_Backend* MEM_FindBackend(const char* name)
+{
+	if (name == NULL)
+		return NULL;
+
+	for (int i = 0; MEM_Backends[i] != NULL; i++)
+	{
+		if (!strcmp(MEM_Backends[i]->Name, name))
+			return MEM_Backends[i];
+	}
+	return NULL;
+}
+
+void MEM_SetBackend(const MEM_Backend* newBackend)
+{
+	if (!attached)
+		backend = newBackend;
+}
+
+const MEM_Backend* MEM_GetBackend(void)
+{
+	return backend;
+}
+
+void MEM_SetRamOrder(MEM_RamOrder order)
+{
+	if (attached)
+		return;
+
+	ramOrder = order;
+	ramOrderSet = 1;
+}
+
+MEM_RamOrder MEM_GetRamOrder(void)
+{
+	return ramOrder;
+}
+
+uint32_t MEM_RamWord(uint32_t word)
+{
+	return ramSwapped ? ByteSwap32(word) : word;
+}
+
+//==========================================================================
+// Purpose: pick a backend and a byte order if none were set, and attach
+// to the emulator
+// Changed Globals: backend, attached, ramOrder, ramSwapped
+//==========================================================================
+uint8_t MEM_Init(void)
+{
+	if (backend == NULL)
+		backend = MEM_FindBackend(getenv("SCUD_MEMORY"));
+#if defined(MEM_DEFAULT_BACKEND)
+	if (backend == NULL)
+		backend = MEM_FindBackend(MEM_DEFAULT_BACKEND);
+#endif
+	if (backend == NULL)
+		backend = MEM_Backends[0];
+
+	const char* order = getenv("SCUD_RAM_ORDER");
+	if (!ramOrderSet && order != NULL && !strcmp(order, "big"))
+		ramOrder = MEM_RamBigEndian;
+	ramSwapped = ramOrder == MEM_RamBigEndian && !HOST_BIG_ENDIAN;
+
+	attached = backend->Attach();
+	return attached;
+}
+
+//==========================================================================
+// Purpose: detach from the emulator, another backend can be set after this
+// Changed Globals: attached
+//==========================================================================
+void MEM_Quit(void)
+{
+	if (!attached)
+		return;
+
+	backend->Detach();
+	attached = 0;
+}
+
+void MEM_UpdateEmuoffset(void)
+{
+	if (attached)
+		backend->Refresh();
+}
+
+// nothing is read or written before MEM_Init succeeds
+static uint8_t MEM_Read(const uint32_t addr, void* buffer, uint32_t size)
+{
+	if (attached && backend->Read(addr, buffer, size))
+		return 1;
+
+	memset(buffer, 0, size);
+	return 0;
+}
+
+static void MEM_Write(const uint32_t addr, const void* data, uint32_t size)
+{
+	if (attached)
+		backend->Write(addr, data, size);
+}
+
+int32_t MEM_ReadInt(const uint32_t addr)
+{
+	uint32_t word;
+	MEM_Read(addr, &word, sizeof(word));
+	return (int32_t)MEM_RamWord(word);
+}
+
+float MEM_ReadFloat(const uint32_t addr)
+{
+	uint32_t word;
+	MEM_Read(addr, &word, sizeof(word));
+	word = MEM_RamWord(word);
+
+	float output;
+	memcpy(&output, &word, sizeof(output));
+	return output;
+}
+
+uint8_t MEM_ReadByte(const uint32_t addr)
+{
+	uint8_t output;
+	MEM_Read(addr, &output, sizeof(output));
+	return output;
+}
+
+void MEM_WriteInt(const uint32_t addr, uint32_t value)
+{
+	uint32_t word = MEM_RamWord(value);
+	MEM_Write(addr, &word, sizeof(word));
+}
+
+// patches are PowerPC instructions, words like any other
+void MEM_PatchWord(const uint32_t addr, uint32_t value)
+{
+	MEM_WriteInt(addr, value);
+}
+
+void MEM_WriteFloat(const uint32_t addr, float value)
+{
+	uint32_t word;
+	memcpy(&word, &value, sizeof(word));
+	MEM_WriteInt(addr, word);
+}
+
+void MEM_WriteByte(const uint32_t addr, uint8_t value)
+{
+	MEM_Write(addr, &value, sizeof(value));
+}
+
+//==========================================================================
+// Purpose: read a whole block of emulator memory with one call, so a
+// struct can be decoded from one consistent copy instead of one read per field
+// The block is in the RAM's byte order, see MEM_RamWord
+// Returns 1 on success, on failure the buffer is zeroed
+//==========================================================================
+uint8_t MEM_ReadBlock(const uint32_t addr, void* buffer, uint32_t size)
+{
+	return MEM_Read(addr, buffer, size);
+}
+
+uint8_t MEM_ReadSpans(const MEM_ReadSpan* spans, uint32_t count)
+{
+	if (attached && backend->ReadSpans(spans, count))
+		return 1;
+
+	for (uint32_t i = 0; i < count; i++)
+		memset(spans[i].Data, 0, spans[i].Size);
+	return 0;
+}
+
+void MEM_WriteSpans(const MEM_Span* spans, uint32_t count)
+{
+	if (attached)
+		backend->WriteSpans(spans, count);
+}
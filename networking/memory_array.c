@@ -0,0 +1,87 @@
+//==========================================================================
+// Array memory backend, the "emulated RAM" is a byte array in this process
+// Picked with SCUD_MEMORY=array
+//
+// There is no emulator on the other end, so this is for tools, benchmarks
+// and trying out the client without a game running. The array is
+// MEM_SHM_SIZE bytes of zeros, emulated address 0 at the start.
+//==========================================================================
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+
+static uint8_t* emuram = NULL;
+
+//==========================================================================
+// Purpose: allocate the array
+// Changed Globals: emuram
+//==========================================================================
+static uint8_t MEM_ArrayAttach(void)
+{
+	if (emuram == NULL)
+		emuram = (uint8_t*)calloc(1, MEM_SHM_SIZE);
+	return emuram != NULL ? 1 : 0;
+}
+
+//==========================================================================
+// Purpose: free the array
+// Changed Globals: emuram
+//==========================================================================
+static void MEM_ArrayDetach(void)
+{
+	free(emuram);
+	emuram = NULL;
+}
+
+static void MEM_ArrayRefresh(void)
+{
+}
+
+static uint8_t MEM_InRange(const uint32_t addr, uint32_t size)
+{
+	return emuram != NULL && addr <= MEM_SHM_SIZE && size <= MEM_SHM_SIZE - addr;
+}
+
+static uint8_t MEM_ArrayRead(uint32_t addr, void* buffer, uint32_t size)
+{
+	if (!MEM_InRange(addr, size))
+		return 0;
+
+	memcpy(buffer, emuram + addr, size);
+	return 1;
+}
+
+static void MEM_ArrayWrite(uint32_t addr, const void* data, uint32_t size)
+{
+	if (MEM_InRange(addr, size))
+		memcpy(emuram + addr, data, size);
+}
+
+static uint8_t MEM_ArrayReadSpans(const MEM_ReadSpan* spans, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!MEM_ArrayRead(spans[i].Addr, spans[i].Data, spans[i].Size))
+			return 0;
+	}
+	return 1;
+}
+
+static void MEM_ArrayWriteSpans(const MEM_Span* spans, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+		MEM_ArrayWrite(spans[i].Addr, spans[i].Data, spans[i].Size);
+}
+
+const MEM_Backend MEM_ArrayBackend =
+{
+	"array",
+	MEM_ArrayAttach,
+	MEM_ArrayDetach,
+	MEM_ArrayRefresh,
+	MEM_ArrayRead,
+	MEM_ArrayWrite,
+	MEM_ArrayReadSpans,
+	MEM_ArrayWriteSpans
+};
@@ -0,0 +1,181 @@
+//==========================================================================
+// Batched writes into emulator memory
+//==========================================================================
+// Writing a remote car field by field is one call into the other process
+// per field. Instead, writes are staged here and flushed once a frame:
+// values that are the same as what we last wrote are dropped, the rest are
+// sorted by address, writes that touch are merged into one span, and the
+// spans are handed to the backend in one go.
+//
+// Dropping a value is only safe for fields nobody but us writes. The game
+// keeps changing some of the values we pin (the race timer counts down),
+// those are staged with the Always writes and go out on every flush. Every
+// MEM_BATCH_REFRESH flushes everything else is written again as well.
+//==========================================================================
+#include <stdint.h>
+#include <string.h>
+#include "memory.h"
+
+// the most writes that can be staged between flushes, 8 cars of 10 fields is 80
+#define MEM_BATCH_MAX_WRITES 256
+
+// every this many flushes, write values even if they did not change
+#define MEM_BATCH_REFRESH 30
+
+// slots in the table of values we last wrote, must be a power of two and well above the number of addresses written
+#define MEM_SHADOW_SIZE 512
+
+typedef struct
+{
+	uint32_t Addr;
+	uint32_t Size;
+	uint8_t Data[4];
+
+	// written even if it is what we wrote last time
+	uint8_t Always;
+}MEM_PendingWrite;
+
+typedef struct
+{
+	uint8_t Used;
+	uint8_t Size;
+	uint32_t Addr;
+	uint8_t Data[4];
+}MEM_ShadowValue;
+
+static MEM_PendingWrite pending[MEM_BATCH_MAX_WRITES];
+static uint32_t pendingCount = 0;
+
+static MEM_ShadowValue shadow[MEM_SHADOW_SIZE];
+static uint32_t flushCount = 0;
+
+//==========================================================================
+// Purpose: find the slot that holds (or will hold) the last value written to addr
+//==========================================================================
+static MEM_ShadowValue* MEM_FindShadow(const uint32_t addr)
+{
+	uint32_t slot = (addr * 2654435761u) & (MEM_SHADOW_SIZE - 1);
+	for (uint32_t i = 0; i < MEM_SHADOW_SIZE; i++)
+	{
+		MEM_ShadowValue* value = &shadow[(slot + i) & (MEM_SHADOW_SIZE - 1)];
+		if (!value->Used || value->Addr == addr)
+			return value;
+	}
+	return NULL;
+}
+
+static void MEM_BatchWrite(const uint32_t addr, const void* data, uint32_t size, uint8_t always)
+{
+	// a full batch goes out early rather than losing writes
+	if (pendingCount == MEM_BATCH_MAX_WRITES)
+		MEM_BatchFlush();
+
+	MEM_PendingWrite* write = &pending[pendingCount++];
+	write->Addr = addr;
+	write->Size = size;
+	write->Always = always;
+	memcpy(write->Data, data, size);
+}
+
+// words are staged in the RAM's byte order, so the flush only moves bytes
+void MEM_BatchWriteInt(const uint32_t addr, uint32_t value)
+{
+	uint32_t word = MEM_RamWord(value);
+	MEM_BatchWrite(addr, &word, sizeof(word), 0);
+}
+
+void MEM_BatchWriteFloat(const uint32_t addr, float value)
+{
+	uint32_t word;
+	memcpy(&word, &value, sizeof(word));
+	MEM_BatchWriteInt(addr, word);
+}
+
+void MEM_BatchWriteByte(const uint32_t addr, uint8_t value)
+{
+	MEM_BatchWrite(addr, &value, sizeof(value), 0);
+}
+
+void MEM_BatchWriteIntAlways(const uint32_t addr, uint32_t value)
+{
+	uint32_t word = MEM_RamWord(value);
+	MEM_BatchWrite(addr, &word, sizeof(word), 1);
+}
+
+void MEM_BatchWriteByteAlways(const uint32_t addr, uint8_t value)
+{
+	MEM_BatchWrite(addr, &value, sizeof(value), 1);
+}
+
+//==========================================================================
+// Purpose: write everything staged since the last flush
+//==========================================================================
+void MEM_BatchFlush(void)
+{
+	static uint8_t bytes[MEM_BATCH_MAX_WRITES * 4];
+	static MEM_Span spans[MEM_BATCH_MAX_WRITES];
+
+	if (pendingCount == 0)
+		return;
+
+	uint8_t refresh = (flushCount++ % MEM_BATCH_REFRESH) == 0;
+
+	// sort by address, an insertion sort keeps the order of writes to the same address and the list is short
+	for (uint32_t i = 1; i < pendingCount; i++)
+	{
+		MEM_PendingWrite write = pending[i];
+		uint32_t j = i;
+		while (j > 0 && pending[j - 1].Addr > write.Addr)
+		{
+			pending[j] = pending[j - 1];
+			j--;
+		}
+		pending[j] = write;
+	}
+
+	uint32_t spanCount = 0;
+	uint32_t used = 0;
+	for (uint32_t i = 0; i < pendingCount; i++)
+	{
+		MEM_PendingWrite* write = &pending[i];
+
+		// only the last write to an address counts
+		if (i + 1 < pendingCount && pending[i + 1].Addr == write->Addr)
+			continue;
+
+		// skip values the emulator already has from us
+		MEM_ShadowValue* last = MEM_FindShadow(write->Addr);
+		if (!refresh && !write->Always && last != NULL && last->Used && last->Size == write->Size && memcmp(last->Data, write->Data, write->Size) == 0)
+			continue;
+
+		if (last != NULL)
+		{
+			last->Used = 1;
+			last->Addr = write->Addr;
+			last->Size = (uint8_t)write->Size;
+			memcpy(last->Data, write->Data, write->Size);
+		}
+
+		memcpy(bytes + used, write->Data, write->Size);
+
+		// a write that starts right where the last span ends joins it, the bytes are already next to each other
+		MEM_Span* span = spanCount > 0 ? &spans[spanCount - 1] : NULL;
+		if (span != NULL && span->Addr + span->Size == write->Addr && (const uint8_t*)span->Data + span->Size == bytes + used)
+		{
+			span->Size += write->Size;
+		}
+		else
+		{
+			span = &spans[spanCount++];
+			span->Addr = write->Addr;
+			span->Data = bytes + used;
+			span->Size = write->Size;
+		}
+		used += write->Size;
+	}
+
+	pendingCount = 0;
+
+	if (spanCount > 0)
+		MEM_WriteSpans(spans, spanCount);
+}
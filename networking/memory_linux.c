@@ -0,0 +1,246 @@
+//==========================================================================
+// Linux memory backend, reads and writes Supermodel's memory with
+// process_vm_readv/process_vm_writev
+// Picked with SCUD_MEMORY=linux, the default on linux unless the
+// networking project is generated with another --memory
+//
+// The client needs permission to look into the emulator, run both as the
+// same user with /proc/sys/kernel/yama/ptrace_scope set to 0, or give the
+// client CAP_SYS_PTRACE.
+//
+// SCUD_EMU_PROCESS overrides the name of the emulator process
+// SCUD_EMU_PTR overrides where in the emulator executable the pointer to
+// the emulated RAM is kept (hex), it differs between Supermodel builds
+//==========================================================================
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "memory.h"
+
+#define EMU_PTR 0x432058
+#define EMU_PROCESS "supermodel"
+
+// process_vm_writev takes at most this many spans in one call
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+static uintptr_t emuoffset = 0;
+static pid_t emupid = 0;
+
+static uintptr_t modBaseAddr;
+
+//==========================================================================
+// Purpose: find a process by name, /proc/<pid>/comm holds the first 15
+// characters of the executable name
+//==========================================================================
+static pid_t GetProcId(const char* procName)
+{
+	pid_t procId = 0;
+	DIR* proc = opendir("/proc");
+	if (proc == NULL)
+		return 0;
+
+	struct dirent* entry;
+	while ((entry = readdir(proc)) != NULL)
+	{
+		if (!isdigit((unsigned char)entry->d_name[0]))
+			continue;
+
+		char path[300];
+		snprintf(path, sizeof(path), "/proc/%s/comm", entry->d_name);
+		FILE* file = fopen(path, "r");
+		if (file == NULL)
+			continue;
+
+		char name[64] = { 0 };
+		if (fgets(name, sizeof(name), file) != NULL)
+		{
+			name[strcspn(name, "\n")] = 0;
+			if (!strncasecmp(name, procName, 15))
+				procId = (pid_t)atoi(entry->d_name);
+		}
+		fclose(file);
+
+		if (procId != 0)
+			break;
+	}
+	closedir(proc);
+
+	return procId;
+}
+
+//==========================================================================
+// Purpose: find where the executable of a process is loaded, the lowest
+// mapping of its file in /proc/<pid>/maps
+//==========================================================================
+static uintptr_t GetModuleBaseAddress(pid_t procId)
+{
+	char path[64];
+	char exe[PATH_MAX] = { 0 };
+	snprintf(path, sizeof(path), "/proc/%d/exe", (int)procId);
+	if (readlink(path, exe, sizeof(exe) - 1) <= 0)
+		return 0;
+
+	snprintf(path, sizeof(path), "/proc/%d/maps", (int)procId);
+	FILE* maps = fopen(path, "r");
+	if (maps == NULL)
+		return 0;
+
+	uintptr_t moduleBaseAddress = 0;
+	char line[PATH_MAX + 128];
+	while (fgets(line, sizeof(line), maps) != NULL)
+	{
+		// start-end perms offset dev inode path
+		unsigned long start = 0;
+		char file[PATH_MAX] = { 0 };
+		if (sscanf(line, "%lx-%*x %*s %*s %*s %*s %4095[^\n]", &start, file) != 2)
+			continue;
+
+		if (!strcmp(file, exe) && (moduleBaseAddress == 0 || start < moduleBaseAddress))
+			moduleBaseAddress = (uintptr_t)start;
+	}
+	fclose(maps);
+
+	return moduleBaseAddress;
+}
+
+static int MEM_ReadRemote(uintptr_t addr, void* buffer, size_t size)
+{
+	struct iovec local = { buffer, size };
+	struct iovec remote = { (void*)addr, size };
+	return process_vm_readv(emupid, &local, 1, &remote, 1, 0) == (ssize_t)size;
+}
+
+static uint8_t MEM_LinuxRead(uint32_t addr, void* buffer, uint32_t size)
+{
+	return MEM_ReadRemote(emuoffset + addr, buffer, size);
+}
+
+static void MEM_LinuxWrite(uint32_t addr, const void* data, uint32_t size)
+{
+	struct iovec local = { (void*)data, size };
+	struct iovec remote = { (void*)(emuoffset + addr), size };
+	process_vm_writev(emupid, &local, 1, &remote, 1, 0);
+}
+
+//==========================================================================
+// Purpose: find the emulator process
+// Changed Globals: emupid, modBaseAddr
+//==========================================================================
+static uint8_t MEM_LinuxAttach(void)
+{
+	const char* gameName = getenv("SCUD_EMU_PROCESS");
+	if (gameName == NULL)
+		gameName = EMU_PROCESS;
+
+	emupid = GetProcId(gameName);
+	if (emupid == 0)
+		return 0;
+
+	modBaseAddr = GetModuleBaseAddress(emupid);
+	return modBaseAddr != 0 ? 1 : 0;
+}
+
+//==========================================================================
+// Purpose: nothing to close, process_vm_* works on the pid
+// Changed Globals: emupid
+//==========================================================================
+static void MEM_LinuxDetach(void)
+{
+	emupid = 0;
+}
+
+static void MEM_LinuxRefresh(void)
+{
+	uintptr_t emuPtr = EMU_PTR;
+	const char* ptrOverride = getenv("SCUD_EMU_PTR");
+	if (ptrOverride != NULL)
+		emuPtr = (uintptr_t)strtoull(ptrOverride, NULL, 16);
+
+	emuoffset = 0;
+	MEM_ReadRemote(modBaseAddr + emuPtr, &emuoffset, sizeof(emuoffset));
+}
+
+//==========================================================================
+// Purpose: gather spans with one process_vm_readv, a span per iovec on each side
+//==========================================================================
+static uint8_t MEM_LinuxReadSpans(const MEM_ReadSpan* spans, uint32_t count)
+{
+	struct iovec local[IOV_MAX];
+	struct iovec remote[IOV_MAX];
+
+	while (count > 0)
+	{
+		uint32_t chunk = count < IOV_MAX ? count : IOV_MAX;
+		size_t size = 0;
+		for (uint32_t i = 0; i < chunk; i++)
+		{
+			local[i].iov_base = spans[i].Data;
+			local[i].iov_len = spans[i].Size;
+			remote[i].iov_base = (void*)(emuoffset + spans[i].Addr);
+			remote[i].iov_len = spans[i].Size;
+			size += spans[i].Size;
+		}
+
+		if (process_vm_readv(emupid, local, chunk, remote, chunk, 0) != (ssize_t)size)
+			return 0;
+
+		spans += chunk;
+		count -= chunk;
+	}
+	return 1;
+}
+
+//==========================================================================
+// Purpose: write the spans of a batch, every span is one iovec on each side
+// so a whole batch is one process_vm_writev
+//==========================================================================
+static void MEM_LinuxWriteSpans(const MEM_Span* spans, uint32_t count)
+{
+	struct iovec local[IOV_MAX];
+	struct iovec remote[IOV_MAX];
+
+	while (count > 0)
+	{
+		uint32_t chunk = count < IOV_MAX ? count : IOV_MAX;
+		for (uint32_t i = 0; i < chunk; i++)
+		{
+			local[i].iov_base = (void*)spans[i].Data;
+			local[i].iov_len = spans[i].Size;
+			remote[i].iov_base = (void*)(emuoffset + spans[i].Addr);
+			remote[i].iov_len = spans[i].Size;
+		}
+
+		process_vm_writev(emupid, local, chunk, remote, chunk, 0);
+
+		spans += chunk;
+		count -= chunk;
+	}
+}
+
+const MEM_Backend MEM_LinuxBackend =
+{
+	"linux",
+	MEM_LinuxAttach,
+	MEM_LinuxDetach,
+	MEM_LinuxRefresh,
+	MEM_LinuxRead,
+	MEM_LinuxWrite,
+	MEM_LinuxReadSpans,
+	MEM_LinuxWriteSpans
+};
+
+#endif // __linux__
@@ -0,0 +1,140 @@
+//==========================================================================
+// Shared memory backend, the Model 3 RAM is mapped straight into the client
+// Picked with SCUD_MEMORY=shm, or by default when the networking project is
+// generated with --memory=shm
+//
+// A cooperating (patched) emulator keeps the emulated RAM in a named shared
+// memory segment, MEM_SHM_NAME, MEM_SHM_SIZE bytes, emulated address 0 at
+// the start. We map the same segment, so every read and write is a plain
+// load or store with no call into the other process at all.
+//
+// SCUD_SHM_NAME overrides the name of the segment
+//==========================================================================
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+static uint8_t* emuram = NULL;
+
+#if defined(_WIN32)
+static HANDLE emumapping = NULL;
+#endif
+
+//==========================================================================
+// Purpose: map the emulator's RAM segment
+// Changed Globals: emuram
+//==========================================================================
+static uint8_t MEM_ShmAttach(void)
+{
+	const char* name = getenv("SCUD_SHM_NAME");
+	if (name == NULL)
+		name = MEM_SHM_NAME;
+
+#if defined(_WIN32)
+	emumapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+	if (emumapping == NULL)
+		return 0;
+
+	emuram = (uint8_t*)MapViewOfFile(emumapping, FILE_MAP_ALL_ACCESS, 0, 0, MEM_SHM_SIZE);
+	if (emuram == NULL)
+	{
+		CloseHandle(emumapping);
+		emumapping = NULL;
+		return 0;
+	}
+#else
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return 0;
+
+	void* mapped = mmap(NULL, MEM_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return 0;
+
+	emuram = (uint8_t*)mapped;
+#endif
+	return 1;
+}
+
+//==========================================================================
+// Purpose: unmap the segment
+// Changed Globals: emuram
+//==========================================================================
+static void MEM_ShmDetach(void)
+{
+	if (emuram == NULL)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(emuram);
+	CloseHandle(emumapping);
+	emumapping = NULL;
+#else
+	munmap(emuram, MEM_SHM_SIZE);
+#endif
+	emuram = NULL;
+}
+
+// the segment is always mapped at the same place, there is no pointer to follow
+static void MEM_ShmRefresh(void)
+{
+}
+
+// reads and writes outside the segment are dropped, a bad address must not crash the client
+static uint8_t MEM_InRange(const uint32_t addr, uint32_t size)
+{
+	return emuram != NULL && addr <= MEM_SHM_SIZE && size <= MEM_SHM_SIZE - addr;
+}
+
+static uint8_t MEM_ShmRead(uint32_t addr, void* buffer, uint32_t size)
+{
+	if (!MEM_InRange(addr, size))
+		return 0;
+
+	memcpy(buffer, emuram + addr, size);
+	return 1;
+}
+
+static void MEM_ShmWrite(uint32_t addr, const void* data, uint32_t size)
+{
+	if (MEM_InRange(addr, size))
+		memcpy(emuram + addr, data, size);
+}
+
+static uint8_t MEM_ShmReadSpans(const MEM_ReadSpan* spans, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!MEM_ShmRead(spans[i].Addr, spans[i].Data, spans[i].Size))
+			return 0;
+	}
+	return 1;
+}
+
+static void MEM_ShmWriteSpans(const MEM_Span* spans, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+		MEM_ShmWrite(spans[i].Addr, spans[i].Data, spans[i].Size);
+}
+
+const MEM_Backend MEM_ShmBackend =
+{
+	"shm",
+	MEM_ShmAttach,
+	MEM_ShmDetach,
+	MEM_ShmRefresh,
+	MEM_ShmRead,
+	MEM_ShmWrite,
+	MEM_ShmReadSpans,
+	MEM_ShmWriteSpans
+};
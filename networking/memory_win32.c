@@ -0,0 +1,158 @@
+//==========================================================================
+// Windows memory backend, reads and writes Supermodel's memory with
+// ReadProcessMemory/WriteProcessMemory
+// Picked with SCUD_MEMORY=win32, the default on windows unless the
+// networking project is generated with another --memory
+//==========================================================================
+#if defined(_WIN32)
+
+#include <stdint.h>
+#include <string.h>
+#include <windows.h>
+#include <tlhelp32.h>
+#include <psapi.h>
+#include "memory.h"
+
+#define EMU_PTR 0x432058
+
+static uint32_t emuoffset = 0;
+static HANDLE emuhandle = NULL;
+
+static uintptr_t modBaseAddr;
+
+
+DWORD GetProcId(const wchar_t* procName)
+{
+	DWORD procId = 0;
+	HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (hSnap != INVALID_HANDLE_VALUE)
+	{
+		PROCESSENTRY32 procEntry;
+		procEntry.dwSize = sizeof(PROCESSENTRY32);
+
+		if (Process32First(hSnap, &procEntry))
+		{
+			do
+			{
+				if (!_wcsicmp(procEntry.szExeFile, procName))
+				{
+					procId = procEntry.th32ProcessID;
+					//std::cout << procId << std::endl;
+					break;
+				}
+			} while (Process32Next(hSnap, &procEntry));
+		}
+	}
+	CloseHandle(hSnap);
+
+	return procId;
+}
+
+uintptr_t GetModuleBaseAddress(DWORD procId, const wchar_t* modName)
+{
+	uintptr_t moduleBaseAddress = 0;
+	HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, procId);
+	if (hSnap != INVALID_HANDLE_VALUE)
+	{
+		MODULEENTRY32 moduleEntry;
+		moduleEntry.dwSize = sizeof(MODULEENTRY32);
+
+		if (Module32First(hSnap, &moduleEntry))
+		{
+			do
+			{
+				if (!_wcsicmp(moduleEntry.szModule, modName))
+				{
+					moduleBaseAddress = (uintptr_t)moduleEntry.modBaseAddr;
+					break;
+				}
+			} while (Module32Next(hSnap, &moduleEntry));
+		}
+	}
+	CloseHandle(hSnap);
+
+	return moduleBaseAddress;
+}
+
+
+//==========================================================================
+// Purpose: initialize dolphin handle and setup for memory injection
+// Changed Globals: emuhandle
+//==========================================================================
+static uint8_t MEM_Win32Attach(void)
+{
+	const wchar_t gameName[] = L"Supermodel.exe";
+	emuhandle = NULL;
+	DWORD procID = GetProcId(gameName);
+	emuhandle = OpenProcess(PROCESS_ALL_ACCESS, NULL, procID);
+	modBaseAddr = GetModuleBaseAddress(procID, gameName);
+	return emuhandle != NULL ? 1 : 0;
+}
+//==========================================================================
+// Purpose: close emuhandle safely
+// Changed Globals: emuhandle
+//==========================================================================
+static void MEM_Win32Detach(void)
+{
+	if(emuhandle != NULL)
+		CloseHandle(emuhandle);
+	emuhandle = NULL;
+}
+
+
+static void MEM_Win32Refresh(void)
+{
+	ReadProcessMemory(emuhandle, (LPVOID)(modBaseAddr + EMU_PTR), &emuoffset, sizeof(emuoffset), NULL);;
+}
+
+static void MEM_ByteSwap32(uint32_t* input)
+{
+	const uint8_t* inputarray = ((uint8_t*)input); // set byte array to input
+	*input = (uint32_t)((inputarray[0] << 24) | (inputarray[1] << 16) | (inputarray[2] << 8) | (inputarray[3])); // reassign input to swapped value
+}
+
+
+static uint8_t MEM_Win32Read(uint32_t addr, void* buffer, uint32_t size)
+{
+	SIZE_T read = 0;
+	return ReadProcessMemory(emuhandle, (LPVOID)(emuoffset + addr), buffer, size, &read) && read == size;
+}
+
+static void MEM_Win32Write(uint32_t addr, const void* data, uint32_t size)
+{
+	WriteProcessMemory(emuhandle, (LPVOID)(emuoffset + addr), data, size, NULL);
+}
+
+//==========================================================================
+// Purpose: gather and scatter, windows has no vectored read or write into
+// another process, so these are one call per span
+//==========================================================================
+static uint8_t MEM_Win32ReadSpans(const MEM_ReadSpan* spans, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!MEM_Win32Read(spans[i].Addr, spans[i].Data, spans[i].Size))
+			return 0;
+	}
+	return 1;
+}
+
+static void MEM_Win32WriteSpans(const MEM_Span* spans, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+		MEM_Win32Write(spans[i].Addr, spans[i].Data, spans[i].Size);
+}
+
+const MEM_Backend MEM_Win32Backend =
+{
+	"win32",
+	MEM_Win32Attach,
+	MEM_Win32Detach,
+	MEM_Win32Refresh,
+	MEM_Win32Read,
+	MEM_Win32Write,
+	MEM_Win32ReadSpans,
+	MEM_Win32WriteSpans
+};
+
+#endif // _WIN32
@@ -0,0 +1,87 @@
+// several messages in one packet
+
+#include "net_batch.h"
+
+#include <string.h>
+
+// the Batch command and the length of the first message, a packet with one message in it leaves them out
+#define BATCH_FRAMING 2
+
+void BatchClear(MessageBatch* batch)
+{
+	if (batch->Writer.Packet != NULL)
+		enet_packet_destroy(batch->Writer.Packet);
+
+	memset(batch, 0, sizeof(MessageBatch));
+}
+
+bool BatchAppend(MessageBatch* batch, const uint8_t* message, size_t size, enet_uint32 flags)
+{
+	if (size == 0 || size > BATCH_MESSAGE_MAX)
+		return false;
+
+	// the first message starts the packet, with the command in front
+	if (batch->Writer.Packet == NULL)
+	{
+		if (!BeginPacket(&batch->Writer, BATCH_CAPACITY, flags))
+			return false;
+
+		PacketWriteByte(&batch->Writer, (uint8_t)Batch);
+	}
+
+	// the length and the message have to fit together, the writer would only notice after the length was written
+	if (batch->Writer.Offset + 1 + size > batch->Writer.Capacity)
+		return false;
+
+	PacketWriteByte(&batch->Writer, (uint8_t)size);
+	memcpy(PacketWriteSpan(&batch->Writer, size), message, size);
+	batch->Count++;
+	return true;
+}
+
+ENetPacket* BatchEnd(MessageBatch* batch)
+{
+	if (batch->Count == 0)
+	{
+		BatchClear(batch);
+		return NULL;
+	}
+
+	// one message doesn't need the framing, it moves down over it. it is a few bytes, the common case of a batch
+	// with several messages in it isn't copied at all
+	if (batch->Count == 1)
+	{
+		uint8_t* data = batch->Writer.Packet->data;
+		batch->Writer.Offset -= BATCH_FRAMING;
+		memmove(data, data + BATCH_FRAMING, batch->Writer.Offset);
+	}
+
+	ENetPacket* packet = EndPacket(&batch->Writer);
+	batch->Count = 0;
+	return packet;
+}
+
+bool BatchNext(PacketReader* reader, PacketReader* message)
+{
+	if (reader->Offset == 0 && reader->Length > 0 && reader->Data[0] != (uint8_t)Batch)
+	{
+		// not a batch, the whole packet is the one message
+		*message = *reader;
+		reader->Offset = reader->Length;
+		return true;
+	}
+
+	if (reader->Offset == 0)
+		PacketReadByte(reader);
+
+	uint8_t size = PacketReadByte(reader);
+	const uint8_t* data = PacketReadSpan(reader, size);
+	if (size == 0 || data == NULL)
+		return false;
+
+	message->Data = data;
+	message->Length = size;
+	message->Offset = 0;
+	message->Overflow = false;
+	return true;
+}
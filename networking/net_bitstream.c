@@ -0,0 +1,395 @@
+// bit level packing for compact messages
+
+#include "net_bitstream.h"
+#include "net_byteorder.h"
+
+#include <math.h>
+#include <string.h>
+
+#define BIT_PI 3.14159265358979f
+
+// on little endian machines the reader loads 8 bytes at a time and the writer stores 4, the bytes are already in the order the bits go
+#if !HOST_BIG_ENDIAN
+#define BIT_WORD_LOADS
+#endif
+
+static uint64_t LowBits(int bits)
+{
+	return ((uint64_t)1 << bits) - 1;
+}
+
+// a ranged float to the nearest step, clamped to the range (NaN ends up at the bottom)
+static uint32_t QuantizeRange(float value, float min, float max, int bits)
+{
+	uint32_t top = (uint32_t)LowBits(bits);
+	float steps = (value - min) * ((float)top / (max - min));
+	if (!(steps > 0))
+		return 0;
+	if (steps >= (float)top)
+		return top;
+	return (uint32_t)(steps + 0.5f);
+}
+
+static float DequantizeRange(uint32_t value, float min, float max, int bits)
+{
+	return min + (float)value * ((max - min) / (float)LowBits(bits));
+}
+
+// angles keep only the part of a turn
+static uint32_t QuantizeAngle(float angle, int bits)
+{
+	// down to one turn first, so any finite angle fits the integer below. an infinite one becomes NaN, which is sent as 0
+	angle = remainderf(angle, 2.0f * BIT_PI);
+	if (!(angle == angle))
+		return 0;
+
+	float steps = angle * ((float)((uint64_t)1 << bits) / (2.0f * BIT_PI));
+	return (uint32_t)((int64_t)floorf(steps + 0.5f) & (int64_t)LowBits(bits));
+}
+
+static float DequantizeAngle(uint32_t value, int bits)
+{
+	int64_t turn = (int64_t)1 << bits;
+	int64_t steps = (int64_t)value >= turn / 2 ? (int64_t)value - turn : (int64_t)value;
+	return (float)steps * (2.0f * BIT_PI / (float)turn);
+}
+
+// writer
+
+void BitWriterInit(BitWriter* writer, uint8_t* data, size_t capacity)
+{
+	writer->Data = data;
+	writer->Capacity = capacity;
+	writer->Offset = 0;
+	writer->Scratch = 0;
+	writer->ScratchBits = 0;
+	writer->Overflow = false;
+}
+
+// move the whole bytes of the scratch into the buffer, this is the only place the writer checks bounds
+static void BitWriterFlush(BitWriter* writer, int minBits)
+{
+	while (writer->ScratchBits >= minBits && writer->ScratchBits > 0)
+	{
+		if (writer->Offset >= writer->Capacity)
+		{
+			writer->Overflow = true;
+			writer->ScratchBits = 0;
+			writer->Scratch = 0;
+			return;
+		}
+
+		writer->Data[writer->Offset++] = (uint8_t)writer->Scratch;
+		writer->Scratch >>= 8;
+		writer->ScratchBits = writer->ScratchBits > 8 ? writer->ScratchBits - 8 : 0;
+	}
+}
+
+size_t BitWriterFinish(BitWriter* writer)
+{
+	BitWriterFlush(writer, 1);
+	return writer->Overflow ? 0 : writer->Offset;
+}
+
+void BitWriteBits(BitWriter* writer, uint32_t value, int bits)
+{
+	// the scratch always has less than 32 bits in it between writes, so 32 more always fit
+	writer->Scratch |= ((uint64_t)value & LowBits(bits)) << writer->ScratchBits;
+	writer->ScratchBits += bits;
+
+	if (writer->ScratchBits < 32)
+		return;
+
+#if defined(BIT_WORD_LOADS)
+	// the low 4 bytes of the scratch are already in the order they go in the buffer
+	if (writer->Offset + 4 <= writer->Capacity)
+	{
+		uint32_t word = (uint32_t)writer->Scratch;
+		memcpy(writer->Data + writer->Offset, &word, sizeof(word));
+		writer->Offset += 4;
+		writer->Scratch >>= 32;
+		writer->ScratchBits -= 32;
+		return;
+	}
+#endif
+
+	BitWriterFlush(writer, 8);
+}
+
+void BitWriteBool(BitWriter* writer, bool value)
+{
+	BitWriteBits(writer, value ? 1 : 0, 1);
+}
+
+// 7 bits at a time, the 8th bit says there is more
+void BitWriteVarint(BitWriter* writer, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		BitWriteBits(writer, (value & 0x7F) | 0x80, 8);
+		value >>= 7;
+	}
+	BitWriteBits(writer, value, 8);
+}
+
+void BitWriteZigZag(BitWriter* writer, int32_t value)
+{
+	BitWriteVarint(writer, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+void BitWriteRangedFloat(BitWriter* writer, float value, float min, float max, int bits)
+{
+	BitWriteBits(writer, QuantizeRange(value, min, max, bits), bits);
+}
+
+void BitWriteAngle(BitWriter* writer, float angle, int bits)
+{
+	BitWriteBits(writer, QuantizeAngle(angle, bits), bits);
+}
+
+// reader
+
+void BitReaderInit(BitReader* reader, const uint8_t* data, size_t length)
+{
+	reader->Data = data;
+	reader->Length = length;
+	reader->Next = 0;
+	reader->Scratch = 0;
+	reader->ScratchBits = 0;
+	reader->Overflow = false;
+}
+
+// top the scratch up to at least 57 bits, bytes past the end of the data are 0
+static void BitReaderRefill(BitReader* reader)
+{
+#if defined(BIT_WORD_LOADS)
+	if (reader->Next + 8 <= reader->Length)
+	{
+		uint64_t word;
+		memcpy(&word, reader->Data + reader->Next, sizeof(word));
+
+		// only the whole bytes that fit are taken, the rest of the word is loaded again next time
+		int take = (64 - reader->ScratchBits) >> 3;
+		reader->Scratch |= word << reader->ScratchBits;
+		reader->Next += take;
+		reader->ScratchBits += take * 8;
+		if (reader->ScratchBits < 64)
+			reader->Scratch &= LowBits(reader->ScratchBits);
+		return;
+	}
+#endif
+
+	while (reader->ScratchBits <= 56 && reader->Next < reader->Length)
+	{
+		reader->Scratch |= (uint64_t)reader->Data[reader->Next] << reader->ScratchBits;
+		reader->ScratchBits += 8;
+		reader->Next++;
+	}
+
+	// past the end, the bits above the scratch are already 0 so the zero bytes only need counting
+	if (reader->ScratchBits <= 56)
+	{
+		int zeros = (64 - reader->ScratchBits) >> 3;
+		reader->Next += zeros;
+		reader->ScratchBits += zeros * 8;
+	}
+}
+
+size_t BitReaderPosition(const BitReader* reader)
+{
+	return reader->Next * 8 - (size_t)reader->ScratchBits;
+}
+
+bool BitReaderOverflow(BitReader* reader)
+{
+	if (BitReaderPosition(reader) > reader->Length * 8)
+		reader->Overflow = true;
+	return reader->Overflow;
+}
+
+uint32_t BitReadBits(BitReader* reader, int bits)
+{
+	if (reader->ScratchBits < bits)
+		BitReaderRefill(reader);
+
+	uint32_t value = (uint32_t)(reader->Scratch & LowBits(bits));
+	reader->Scratch >>= bits;
+	reader->ScratchBits -= bits;
+	return value;
+}
+
+bool BitReadBool(BitReader* reader)
+{
+	return BitReadBits(reader, 1) != 0;
+}
+
+uint32_t BitReadVarint(BitReader* reader)
+{
+	uint32_t value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		uint32_t group = BitReadBits(reader, 8);
+		value |= (group & 0x7F) << shift;
+		if (!(group & 0x80))
+			break;
+	}
+	return value;
+}
+
+int32_t BitReadZigZag(BitReader* reader)
+{
+	uint32_t value = BitReadVarint(reader);
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+float BitReadRangedFloat(BitReader* reader, float min, float max, int bits)
+{
+	return DequantizeRange(BitReadBits(reader, bits), min, max, bits);
+}
+
+float BitReadAngle(BitReader* reader, int bits)
+{
+	return DequantizeAngle(BitReadBits(reader, bits), bits);
+}
+
+// structs
+
+static uint32_t LoadMember(const uint8_t* member, int size, bool isSigned)
+{
+	if (size == 1)
+		return isSigned ? (uint32_t)(int32_t)*(const int8_t*)member : *member;
+
+	if (size == 2)
+	{
+		uint16_t value;
+		memcpy(&value, member, sizeof(value));
+		return isSigned ? (uint32_t)(int32_t)(int16_t)value : value;
+	}
+
+	uint32_t value;
+	memcpy(&value, member, sizeof(value));
+	return value;
+}
+
+static void StoreMember(uint8_t* member, int size, uint32_t value)
+{
+	if (size == 1)
+	{
+		*member = (uint8_t)value;
+	}
+	else if (size == 2)
+	{
+		uint16_t small = (uint16_t)value;
+		memcpy(member, &small, sizeof(small));
+	}
+	else
+	{
+		memcpy(member, &value, sizeof(value));
+	}
+}
+
+static size_t BitStructMinBits(const BitField* fields, int count)
+{
+	size_t bits = 0;
+	for (int i = 0; i < count; i++)
+		bits += (fields[i].Kind == BitFieldVarint || fields[i].Kind == BitFieldZigZag) ? BIT_VARINT_MIN_BITS : fields[i].Bits;
+	return bits;
+}
+
+size_t BitStructMaxBits(const BitField* fields, int count)
+{
+	size_t bits = 0;
+	for (int i = 0; i < count; i++)
+		bits += (fields[i].Kind == BitFieldVarint || fields[i].Kind == BitFieldZigZag) ? 40 : fields[i].Bits;
+	return bits;
+}
+
+void BitWriteStruct(BitWriter* writer, const BitField* fields, int count, const void* source)
+{
+	const uint8_t* base = (const uint8_t*)source;
+	for (int i = 0; i < count; i++)
+	{
+		const BitField* field = &fields[i];
+		const uint8_t* member = base + field->Offset;
+		float value;
+
+		switch (field->Kind)
+		{
+			case BitFieldUInt:
+				BitWriteBits(writer, LoadMember(member, field->Size, false), field->Bits);
+				break;
+
+			case BitFieldBool:
+				BitWriteBool(writer, LoadMember(member, field->Size, false) != 0);
+				break;
+
+			case BitFieldVarint:
+				BitWriteVarint(writer, LoadMember(member, field->Size, false));
+				break;
+
+			case BitFieldZigZag:
+				BitWriteZigZag(writer, (int32_t)LoadMember(member, field->Size, true));
+				break;
+
+			case BitFieldRangedFloat:
+				memcpy(&value, member, sizeof(value));
+				BitWriteRangedFloat(writer, value, field->Min, field->Max, field->Bits);
+				break;
+
+			case BitFieldAngle:
+				memcpy(&value, member, sizeof(value));
+				BitWriteAngle(writer, value, field->Bits);
+				break;
+		}
+	}
+}
+
+bool BitReadStruct(BitReader* reader, const BitField* fields, int count, void* dest)
+{
+	// the one bounds check, after this the fixed width fields can't run out of data
+	if (BitReaderPosition(reader) + BitStructMinBits(fields, count) > reader->Length * 8)
+	{
+		reader->Overflow = true;
+		return false;
+	}
+
+	uint8_t* base = (uint8_t*)dest;
+	for (int i = 0; i < count; i++)
+	{
+		const BitField* field = &fields[i];
+		uint8_t* member = base + field->Offset;
+		float value;
+
+		switch (field->Kind)
+		{
+			case BitFieldUInt:
+				StoreMember(member, field->Size, BitReadBits(reader, field->Bits));
+				break;
+
+			case BitFieldBool:
+				StoreMember(member, field->Size, BitReadBool(reader) ? 1 : 0);
+				break;
+
+			case BitFieldVarint:
+				StoreMember(member, field->Size, BitReadVarint(reader));
+				break;
+
+			case BitFieldZigZag:
+				StoreMember(member, field->Size, (uint32_t)BitReadZigZag(reader));
+				break;
+
+			case BitFieldRangedFloat:
+				value = BitReadRangedFloat(reader, field->Min, field->Max, field->Bits);
+				memcpy(member, &value, sizeof(value));
+				break;
+
+			case BitFieldAngle:
+				value = BitReadAngle(reader, field->Bits);
+				memcpy(member, &value, sizeof(value));
+				break;
+		}
+	}
+
+	// only varints can still have run past the end
+	return !BitReaderOverflow(reader);
+}
@@ -0,0 +1,159 @@
+// quantized car state for the wire
+
+#include "net_car_codec.h"
+
+#include "net_bitstream.h"
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define CODEC_PI 3.14159265358979f
+
+// the range and resolution of every field, see the error budget in net_car_codec.h
+// the ranges end one step short of the round number, so the steps are exact powers of two
+#define POSITION_XZ_BITS 18
+#define POSITION_XZ_MIN -4096.0f
+#define POSITION_XZ_MAX (4096.0f - 1.0f / 32.0f)
+
+#define POSITION_Y_BITS 12
+#define POSITION_Y_MIN -128.0f
+#define POSITION_Y_MAX (128.0f - 1.0f / 16.0f)
+
+#define YAW_BITS 12
+
+// pitch has the same step as yaw, over a quarter of the turn
+#define PITCH_BITS 10
+#define PITCH_MIN (-CODEC_PI / 4.0f)
+#define PITCH_MAX (PITCH_MIN + 1023.0f * 2.0f * CODEC_PI / (1 << YAW_BITS))
+
+#define SPEED_BITS 10
+#define SPEED_MIN 0.0f
+#define SPEED_MAX 511.5f
+
+#define CAR_BITS 3
+#define CAR_NUMBER_BITS 8
+
+static const BitField MotionFields[] =
+{
+	{ BitFieldRangedFloat, offsetof(CarState, X), sizeof(float), POSITION_XZ_BITS, POSITION_XZ_MIN, POSITION_XZ_MAX },
+	{ BitFieldRangedFloat, offsetof(CarState, Z), sizeof(float), POSITION_XZ_BITS, POSITION_XZ_MIN, POSITION_XZ_MAX },
+	{ BitFieldRangedFloat, offsetof(CarState, Y), sizeof(float), POSITION_Y_BITS, POSITION_Y_MIN, POSITION_Y_MAX },
+	{ BitFieldAngle, offsetof(CarState, Yaw), sizeof(float), YAW_BITS, 0, 0 },
+	{ BitFieldRangedFloat, offsetof(CarState, Pitch), sizeof(float), PITCH_BITS, PITCH_MIN, PITCH_MAX },
+	{ BitFieldRangedFloat, offsetof(CarState, Speed), sizeof(float), SPEED_BITS, SPEED_MIN, SPEED_MAX },
+};
+
+static const BitField IdentityFields[] =
+{
+	{ BitFieldBool, offsetof(CarState, BrakeLight), sizeof(uint8_t), 1, 0, 0 },
+	{ BitFieldUInt, offsetof(CarState, Car), sizeof(uint8_t), CAR_BITS, 0, 0 },
+	{ BitFieldUInt, offsetof(CarState, CarNumber), sizeof(uint8_t), CAR_NUMBER_BITS, 0, 0 },
+};
+
+#define FIELD_COUNT(fields) ((int)(sizeof(fields) / sizeof(fields[0])))
+
+// the clamp counts, cars are packed on the client's network thread and on every server worker
+static atomic_uint ClampedPosition;
+static atomic_uint ClampedHeight;
+static atomic_uint ClampedPitch;
+static atomic_uint ClampedSpeed;
+static atomic_uint YawTurns;
+
+// NaN counts as out of range too, it is packed as the bottom of the range
+static void CountClamp(atomic_uint* counter, float value, float min, float max)
+{
+	if (!(value >= min && value <= max))
+		atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+static void CountClamps(const CarState* car)
+{
+	CountClamp(&ClampedPosition, car->X, POSITION_XZ_MIN, POSITION_XZ_MAX);
+	CountClamp(&ClampedPosition, car->Z, POSITION_XZ_MIN, POSITION_XZ_MAX);
+	CountClamp(&ClampedHeight, car->Y, POSITION_Y_MIN, POSITION_Y_MAX);
+	CountClamp(&ClampedPitch, car->Pitch, PITCH_MIN, PITCH_MAX);
+	CountClamp(&ClampedSpeed, car->Speed, SPEED_MIN, SPEED_MAX);
+	CountClamp(&YawTurns, car->Yaw, -2.0f * CODEC_PI, 2.0f * CODEC_PI);
+}
+
+void CarCodecGetClamps(CarCodecClamps* clamps)
+{
+	clamps->Position = atomic_load_explicit(&ClampedPosition, memory_order_relaxed);
+	clamps->Height = atomic_load_explicit(&ClampedHeight, memory_order_relaxed);
+	clamps->Pitch = atomic_load_explicit(&ClampedPitch, memory_order_relaxed);
+	clamps->Speed = atomic_load_explicit(&ClampedSpeed, memory_order_relaxed);
+	clamps->YawTurns = atomic_load_explicit(&YawTurns, memory_order_relaxed);
+}
+
+static void EncodeFields(const BitField* fields, int count, const CarState* car, uint8_t* data, size_t size)
+{
+	BitWriter writer;
+	BitWriterInit(&writer, data, size);
+	BitWriteStruct(&writer, fields, count, car);
+	BitWriterFinish(&writer);
+}
+
+static void DecodeFields(const BitField* fields, int count, const uint8_t* data, size_t size, CarState* car)
+{
+	BitReader reader;
+	BitReaderInit(&reader, data, size);
+	BitReadStruct(&reader, fields, count, car);
+}
+
+void EncodeCarMotion(const CarState* car, uint8_t* data)
+{
+	CountClamps(car);
+	EncodeFields(MotionFields, FIELD_COUNT(MotionFields), car, data, CAR_MOTION_SIZE);
+}
+
+void DecodeCarMotion(const uint8_t* data, CarState* car)
+{
+	DecodeFields(MotionFields, FIELD_COUNT(MotionFields), data, CAR_MOTION_SIZE, car);
+}
+
+void EncodeCarIdentity(const CarState* car, uint8_t* data)
+{
+	EncodeFields(IdentityFields, FIELD_COUNT(IdentityFields), car, data, CAR_IDENTITY_SIZE);
+}
+
+void DecodeCarIdentity(const uint8_t* data, CarState* car)
+{
+	DecodeFields(IdentityFields, FIELD_COUNT(IdentityFields), data, CAR_IDENTITY_SIZE, car);
+}
+
+void QuantizeCarState(CarState* car)
+{
+	uint8_t data[CAR_MOTION_SIZE + CAR_IDENTITY_SIZE];
+	EncodeCarMotion(car, data);
+	EncodeCarIdentity(car, data + CAR_MOTION_SIZE);
+	DecodeCarMotion(data, car);
+	DecodeCarIdentity(data + CAR_MOTION_SIZE, car);
+}
+
+void PacketWriteCarMotion(PacketWriter* writer, const CarState* car)
+{
+	uint8_t* data = PacketWriteSpan(writer, CAR_MOTION_SIZE);
+	if (data != NULL)
+		EncodeCarMotion(car, data);
+}
+
+void PacketWriteCarIdentity(PacketWriter* writer, const CarState* car)
+{
+	uint8_t* data = PacketWriteSpan(writer, CAR_IDENTITY_SIZE);
+	if (data != NULL)
+		EncodeCarIdentity(car, data);
+}
+
+void PacketReadCarMotion(PacketReader* reader, CarState* car)
+{
+	const uint8_t* data = PacketReadSpan(reader, CAR_MOTION_SIZE);
+	if (data != NULL)
+		DecodeCarMotion(data, car);
+}
+
+void PacketReadCarIdentity(PacketReader* reader, CarState* car)
+{
+	const uint8_t* data = PacketReadSpan(reader, CAR_IDENTITY_SIZE);
+	if (data != NULL)
+		DecodeCarIdentity(data, car);
+}
@@ -27,73 +27,162 @@
 **********************************************************************************************/
 
 #include "net_common.h"
+#include "net_byteorder.h"
 
+#include <string.h>
 
-// Utility functions to read data out of a packet
-// Optimally this would go into a library that was shared by the client and the server
+#if !defined(_WIN32)
+#include <time.h>
+#endif
 
-/// <summary>
-/// Read one byte out of a packet, from an offset, and update that offset to the next location to read from
-/// </summary>
-/// <param name="packet">The packet to read from</param>
-/// <param name="offset">A pointer to an offset that is updated, this should be passed to other read functions so they read from the correct place</param>
-/// <returns>The byte read</returns>
-uint8_t ReadByte(ENetPacket* packet, size_t* offset)
+
+// Packet writer and reader
+
+bool BeginPacket(PacketWriter* writer, size_t capacity, enet_uint32 flags)
 {
-	// make sure we have not gone past the end of the data we were sent
-	if (*offset > packet->dataLength)
-		return 0;
+	// with no data, enet allocates the packet and its data in one block and leaves the data for us to fill in
+	writer->Packet = enet_packet_create(NULL, capacity, flags);
+	writer->Offset = 0;
+	writer->Capacity = capacity;
+	writer->Overflow = writer->Packet == NULL;
 
-	// cast the data to a byte so we can increment it in 1 byte chunks
-	uint8_t* ptr = (uint8_t*)packet->data;
+	return writer->Packet != NULL;
+}
+
+ENetPacket* EndPacket(PacketWriter* writer)
+{
+	ENetPacket* packet = writer->Packet;
+	writer->Packet = NULL;
 
-	// get the byte at the current offset
-	uint8_t data = ptr[(*offset)];
+	if (packet == NULL)
+		return NULL;
 
-	// move the offset over 1 byte for the next read
-	*offset = *offset + 1;
+	if (writer->Overflow)
+	{
+		enet_packet_destroy(packet);
+		return NULL;
+	}
 
+	// only send what was written, the rest of the block is freed with the packet
+	packet->dataLength = writer->Offset;
+	return packet;
+}
+
+uint8_t* PacketWriteSpan(PacketWriter* writer, size_t size)
+{
+	if (writer->Overflow || writer->Offset + size > writer->Capacity)
+	{
+		writer->Overflow = true;
+		return NULL;
+	}
+
+	uint8_t* data = writer->Packet->data + writer->Offset;
+	writer->Offset += size;
 	return data;
 }
 
-/// <summary>
-/// Read a signed short from the network packet
-/// Note that this assumes the packet is in the host's byte ordering
-/// In reality read/write code should use ntohs and htons to convert from network byte order to host byte order, so both big endian and little endian machines can play together
-/// </summary>
-/// <param name="packet">The packet to read from<</param>
-/// <param name="offset">A pointer to an offset that is updated, this should be passed to other read functions so they read from the correct place</param>
-/// <returns>The signed short that is read</returns>
-int16_t ReadShort(ENetPacket* packet, size_t* offset)
+void PacketWriteByte(PacketWriter* writer, uint8_t value)
 {
-	// make sure we have not gone past the end of the data we were sent
-	if (*offset > packet->dataLength)
-		return 0;
+	uint8_t* data = PacketWriteSpan(writer, 1);
+	if (data != NULL)
+		*data = value;
+}
 
-	// cast the data to a byte at the offset
-	uint8_t* data = (uint8_t*)packet->data;
-	data += (*offset);
+// multi-byte values go on the wire little endian (net_byteorder.h)
+void PacketWriteShort(PacketWriter* writer, int16_t value)
+{
+	uint16_t wire = LittleEndian16(value);
+	uint8_t* data = PacketWriteSpan(writer, sizeof(wire));
+	if (data != NULL)
+		memcpy(data, &wire, sizeof(wire));
+}
 
-	// move the offset over 2 bytes for the next read
-	*offset = (*offset) + 2;
+void PacketWriteUInt(PacketWriter* writer, uint32_t value)
+{
+	uint32_t wire = LittleEndian32(value);
+	uint8_t* data = PacketWriteSpan(writer, sizeof(wire));
+	if (data != NULL)
+		memcpy(data, &wire, sizeof(wire));
+}
 
-	// cast the data pointer to a short and return a copy
-	return *(int16_t*)data;
+void PacketWriteFloat(PacketWriter* writer, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	PacketWriteUInt(writer, bits);
 }
 
-float ReadFloat(ENetPacket* packet, size_t* offset)
+void BeginRead(PacketReader* reader, ENetPacket* packet)
 {
-	// make sure we have not gone past the end of the data we were sent
-	if (*offset > packet->dataLength)
-		return 0;
+	reader->Data = packet->data;
+	reader->Length = packet->dataLength;
+	reader->Offset = 0;
+	reader->Overflow = false;
+}
 
-	// cast the data to a byte at the offset
-	uint8_t* data = (uint8_t*)packet->data;
-	data += (*offset);
+bool PacketCanRead(const PacketReader* reader, size_t size)
+{
+	return !reader->Overflow && reader->Offset + size <= reader->Length;
+}
 
-	// move the offset over 2 bytes for the next read
-	*offset = (*offset) + 4;
+const uint8_t* PacketReadSpan(PacketReader* reader, size_t size)
+{
+	if (!PacketCanRead(reader, size))
+	{
+		reader->Overflow = true;
+		return NULL;
+	}
+
+	const uint8_t* data = reader->Data + reader->Offset;
+	reader->Offset += size;
+	return data;
+}
+
+uint8_t PacketReadByte(PacketReader* reader)
+{
+	const uint8_t* data = PacketReadSpan(reader, 1);
+	return data != NULL ? *data : 0;
+}
+
+int16_t PacketReadShort(PacketReader* reader)
+{
+	uint16_t wire = 0;
+	const uint8_t* data = PacketReadSpan(reader, sizeof(wire));
+	if (data != NULL)
+		memcpy(&wire, data, sizeof(wire));
+	return (int16_t)LittleEndian16(wire);
+}
+
+uint32_t PacketReadUInt(PacketReader* reader)
+{
+	uint32_t wire = 0;
+	const uint8_t* data = PacketReadSpan(reader, sizeof(wire));
+	if (data != NULL)
+		memcpy(&wire, data, sizeof(wire));
+	return LittleEndian32(wire);
+}
 
-	// cast the data pointer to a short and return a copy
-	return *(float*)data;
+float PacketReadFloat(PacketReader* reader)
+{
+	uint32_t bits = PacketReadUInt(reader);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+uint64_t NetTimeMicros(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	// split the division so the multiply can't overflow
+	return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000 + ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
 }
@@ -0,0 +1,95 @@
+// the functions for every message in NET_MESSAGES
+
+#include "net_messages.h"
+#include "net_byteorder.h"
+
+#include <string.h>
+
+// how every field type goes in and out of the wire
+// the multi-byte types are little endian, the same as PacketWriteUInt and the rest of net_common
+
+static void StoreByte(uint8_t* data, const uint8_t* value)
+{
+	*data = *value;
+}
+
+static void LoadByte(const uint8_t* data, uint8_t* value)
+{
+	*value = *data;
+}
+
+static void StoreUInt(uint8_t* data, const uint32_t* value)
+{
+	uint32_t wire = LittleEndian32(*value);
+	memcpy(data, &wire, sizeof(wire));
+}
+
+static void LoadUInt(const uint8_t* data, uint32_t* value)
+{
+	uint32_t wire;
+	memcpy(&wire, data, sizeof(wire));
+	*value = LittleEndian32(wire);
+}
+
+static void StoreCar(uint8_t* data, const CarState* value)
+{
+	EncodeCarMotion(value, data);
+	EncodeCarIdentity(value, data + CAR_MOTION_SIZE);
+}
+
+static void LoadCar(const uint8_t* data, CarState* value)
+{
+	DecodeCarMotion(data, value);
+	DecodeCarIdentity(data + CAR_MOTION_SIZE, value);
+}
+
+// every field is at an offset the compiler knows, so a message packs with no bounds checks and no calls per field
+#define NET_ENCODE_FIELD(type, name) Store##type(data, &message->name); data += NET_SIZE_##type;
+#define NET_ENCODE(command, fields) \
+	void Encode##command(const command##Message* message, uint8_t* data) \
+	{ \
+		(void)message; \
+		*data++ = (uint8_t)command; \
+		fields \
+	}
+NET_MESSAGES(NET_ENCODE, NET_ENCODE_FIELD)
+
+// anything in the struct that is not on the wire (the timing of a car) comes back as 0
+#define NET_DECODE_FIELD(type, name) Load##type(data, &message->name); data += NET_SIZE_##type;
+#define NET_DECODE(command, fields) \
+	void Decode##command(const uint8_t* data, command##Message* message) \
+	{ \
+		memset(message, 0, sizeof(*message)); \
+		message->Command = *data++; \
+		fields \
+	}
+NET_MESSAGES(NET_DECODE, NET_DECODE_FIELD)
+
+// the packet functions only ever check the size once, for the whole message
+#define NET_PACKET(command, fields) \
+	bool PacketWrite##command(PacketWriter* writer, const command##Message* message) \
+	{ \
+		uint8_t* data = PacketWriteSpan(writer, command##MessageSize); \
+		if (data == NULL) \
+			return false; \
+		Encode##command(message, data); \
+		return true; \
+	} \
+	\
+	bool PacketRead##command(PacketReader* reader, command##Message* message) \
+	{ \
+		if (!PacketCanRead(reader, command##MessageSize) || reader->Data[reader->Offset] != (uint8_t)command) \
+			return false; \
+		Decode##command(PacketReadSpan(reader, command##MessageSize), message); \
+		return true; \
+	} \
+	\
+	ENetPacket* Create##command##Packet(const command##Message* message, enet_uint32 flags) \
+	{ \
+		PacketWriter writer; \
+		if (!BeginPacket(&writer, command##MessageSize, flags)) \
+			return NULL; \
+		PacketWrite##command(&writer, message); \
+		return EndPacket(&writer); \
+	}
+NET_MESSAGES(NET_PACKET, NET_IGNORE_FIELD)
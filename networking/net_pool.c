@@ -0,0 +1,147 @@
+// a pool allocator for enet
+
+#include "net_pool.h"
+#include "enet.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define POOL_THREAD_LOCAL __declspec(thread)
+#else
+#define POOL_THREAD_LOCAL _Thread_local
+#endif
+
+// every block starts with a header that says which size class it came from, so free doesn't need to be told the size
+// it is 16 bytes so the memory after it keeps the same alignment malloc gives us
+#define POOL_HEADER_SIZE 16
+
+// the size class used for blocks bigger than POOL_MAX_BLOCK
+#define POOL_CLASS_LARGE 0xFF
+
+typedef union
+{
+	uint8_t Class;
+	uint8_t Padding[POOL_HEADER_SIZE];
+}PoolHeader;
+
+// a free block, the link to the next one is kept where the caller's data would be
+typedef struct PoolBlock
+{
+	struct PoolBlock* Next;
+}PoolBlock;
+
+// the free lists of one thread
+typedef struct
+{
+	PoolBlock* Free[POOL_CLASS_COUNT];
+	uint32_t FreeCount[POOL_CLASS_COUNT];
+	NetPoolStats Stats;
+}ThreadPool;
+
+// 64 bytes covers the small enet structures like acknowledgements, 128 and 256 the command nodes and small packets,
+// and 2048 a packet of a full MTU
+static const size_t ClassSizes[POOL_CLASS_COUNT] = { 64, 128, 256, 512, 1024, 2048 };
+
+static POOL_THREAD_LOCAL ThreadPool Pool;
+
+static int GetSizeClass(size_t size)
+{
+	for (int i = 0; i < POOL_CLASS_COUNT; i++)
+	{
+		if (size <= ClassSizes[i])
+			return i;
+	}
+	return POOL_CLASS_LARGE;
+}
+
+int NetPoolInitialize(void)
+{
+	ENetCallbacks callbacks;
+	memset(&callbacks, 0, sizeof(callbacks));
+	callbacks.malloc = NetPoolAlloc;
+	callbacks.free = NetPoolFree;
+
+	return enet_initialize_with_callbacks(ENET_VERSION, &callbacks);
+}
+
+void* NetPoolAlloc(size_t size)
+{
+	int sizeClass = GetSizeClass(size);
+
+	PoolHeader* header = NULL;
+	if (sizeClass == POOL_CLASS_LARGE)
+	{
+		Pool.Stats.Large++;
+		header = (PoolHeader*)malloc(POOL_HEADER_SIZE + size);
+	}
+	else if (Pool.Free[sizeClass] != NULL)
+	{
+		Pool.Stats.Hits++;
+		Pool.Stats.Cached--;
+
+		PoolBlock* block = Pool.Free[sizeClass];
+		Pool.Free[sizeClass] = block->Next;
+		Pool.FreeCount[sizeClass]--;
+
+		header = (PoolHeader*)((uint8_t*)block - POOL_HEADER_SIZE);
+	}
+	else
+	{
+		// always allocate the whole class, so the block can be reused for anything in it
+		Pool.Stats.Misses++;
+		header = (PoolHeader*)malloc(POOL_HEADER_SIZE + ClassSizes[sizeClass]);
+	}
+
+	if (header == NULL)
+		return NULL;
+
+	header->Class = (uint8_t)sizeClass;
+	return (uint8_t*)header + POOL_HEADER_SIZE;
+}
+
+void NetPoolFree(void* memory)
+{
+	if (memory == NULL)
+		return;
+
+	PoolHeader* header = (PoolHeader*)((uint8_t*)memory - POOL_HEADER_SIZE);
+	int sizeClass = header->Class;
+
+	// big blocks, and blocks past what we want to keep around, go back to the system
+	if (sizeClass == POOL_CLASS_LARGE || Pool.FreeCount[sizeClass] >= POOL_MAX_FREE)
+	{
+		if (sizeClass != POOL_CLASS_LARGE)
+			Pool.Stats.Released++;
+
+		free(header);
+		return;
+	}
+
+	PoolBlock* block = (PoolBlock*)memory;
+	block->Next = Pool.Free[sizeClass];
+	Pool.Free[sizeClass] = block;
+	Pool.FreeCount[sizeClass]++;
+	Pool.Stats.Cached++;
+}
+
+void NetPoolGetStats(NetPoolStats* stats)
+{
+	*stats = Pool.Stats;
+}
+
+void NetPoolReleaseThread(void)
+{
+	for (int i = 0; i < POOL_CLASS_COUNT; i++)
+	{
+		while (Pool.Free[i] != NULL)
+		{
+			PoolBlock* block = Pool.Free[i];
+			Pool.Free[i] = block->Next;
+			free((uint8_t*)block - POOL_HEADER_SIZE);
+			Pool.Stats.Released++;
+		}
+		Pool.FreeCount[i] = 0;
+	}
+	Pool.Stats.Cached = 0;
+}
@@ -0,0 +1,185 @@
+// world snapshots shared by the client and the server
+
+#include "net_snapshot.h"
+#include "net_car_codec.h"
+#include "net_messages.h"
+
+#include <string.h>
+
+WorldSnapshot* StoreSnapshot(SnapshotHistory* history, uint32_t tick)
+{
+	WorldSnapshot* snapshot = &history->Snapshots[tick & (SNAPSHOT_HISTORY - 1)];
+	snapshot->Tick = tick;
+	return snapshot;
+}
+
+const WorldSnapshot* FindSnapshot(const SnapshotHistory* history, uint32_t tick)
+{
+	if (tick == 0)
+		return NULL;
+
+	// the slot may have been reused by a newer tick
+	const WorldSnapshot* snapshot = &history->Snapshots[tick & (SNAPSHOT_HISTORY - 1)];
+	if (snapshot->Tick != tick)
+		return NULL;
+
+	return snapshot;
+}
+
+// compare the bits of a float rather than the value, so the receiver always ends up with exactly what we have
+// the server only ever holds cars that came over the wire, so their values are already on the steps of the codec
+static bool FloatChanged(float a, float b)
+{
+	return memcmp(&a, &b, sizeof(float)) != 0;
+}
+
+uint8_t GetCarChanges(const CarState* state, const CarState* baseline)
+{
+	uint8_t fields = 0;
+
+	if (FloatChanged(state->X, baseline->X) || FloatChanged(state->Y, baseline->Y) || FloatChanged(state->Z, baseline->Z)
+		|| FloatChanged(state->Pitch, baseline->Pitch) || FloatChanged(state->Yaw, baseline->Yaw) || FloatChanged(state->Speed, baseline->Speed))
+		fields |= CarFieldMotion;
+	if (state->BrakeLight != baseline->BrakeLight || state->Car != baseline->Car || state->CarNumber != baseline->CarNumber)
+		fields |= CarFieldIdentity;
+	if (state->SampleTime != baseline->SampleTime || state->RelayDelay != baseline->RelayDelay)
+		fields |= CarFieldTiming;
+
+	return fields;
+}
+
+// how many bytes a car takes up on the wire, its field mask and the fields in it
+static size_t GetCarDeltaSize(uint8_t fields)
+{
+	size_t size = 1;
+	if (fields & CarFieldMotion)
+		size += CAR_MOTION_SIZE;
+	if (fields & CarFieldIdentity)
+		size += CAR_IDENTITY_SIZE;
+	if (fields & CarFieldTiming)
+		size += 6;
+	return size;
+}
+
+// write the fields of a car that are set in the mask, in the order they are declared
+static void WriteCarDelta(PacketWriter* writer, const CarState* state, uint8_t fields)
+{
+	PacketWriteByte(writer, fields);
+
+	if (fields & CarFieldMotion)
+		PacketWriteCarMotion(writer, state);
+	if (fields & CarFieldIdentity)
+		PacketWriteCarIdentity(writer, state);
+	if (fields & CarFieldTiming)
+	{
+		PacketWriteUInt(writer, state->SampleTime);
+		PacketWriteShort(writer, (int16_t)state->RelayDelay);
+	}
+}
+
+// read the fields of a car that are set in the mask over the top of the baseline values
+static void ReadCarDelta(PacketReader* reader, CarState* state, uint8_t fields)
+{
+	if (fields & CarFieldMotion)
+		PacketReadCarMotion(reader, state);
+	if (fields & CarFieldIdentity)
+		PacketReadCarIdentity(reader, state);
+	if (fields & CarFieldTiming)
+	{
+		state->SampleTime = PacketReadUInt(reader);
+		state->RelayDelay = (uint16_t)PacketReadShort(reader);
+	}
+}
+
+bool PrepareWorldSnapshot(SnapshotDelta* delta, const WorldSnapshot* world, const WorldSnapshot* baseline, int exceptPlayerId, bool withTiming)
+{
+	// the receiver never gets the excepted player, so their history doesn't have them either
+	uint8_t except = exceptPlayerId >= 0 ? (uint8_t)(1 << exceptPlayerId) : 0;
+	uint8_t present = world->Present & ~except;
+	uint8_t basePresent = baseline != NULL ? baseline->Present & ~except : 0;
+
+	delta->Present = present;
+	delta->Size = UpdateWorldMessageSize;
+	bool changed = baseline == NULL || basePresent != present;
+	uint8_t sendable = withTiming ? (CarFieldAll | CarFieldTiming) : CarFieldAll;
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		delta->Fields[i] = 0;
+		if (!(present & (1 << i)))
+			continue;
+
+		// cars the receiver has never seen need every field
+		uint8_t fields = sendable;
+		if (basePresent & (1 << i))
+			fields = GetCarChanges(&world->Cars[i], &baseline->Cars[i]) & sendable;
+
+		if (fields != 0)
+			changed = true;
+
+		delta->Fields[i] = fields;
+		delta->Size += GetCarDeltaSize(fields);
+	}
+
+	return changed;
+}
+
+void WriteWorldSnapshot(PacketWriter* writer, const WorldSnapshot* world, const WorldSnapshot* baseline, const SnapshotDelta* delta)
+{
+	UpdateWorldMessage header = { 0 };
+	header.Tick = world->Tick;
+	header.BaseTick = baseline != NULL ? baseline->Tick : 0;
+	header.Present = delta->Present;
+	PacketWriteUpdateWorld(writer, &header);
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (delta->Present & (1 << i))
+			WriteCarDelta(writer, &world->Cars[i], delta->Fields[i]);
+	}
+}
+
+bool ReadWorldSnapshot(PacketReader* reader, const SnapshotHistory* history, WorldSnapshot* world)
+{
+	UpdateWorldMessage header;
+	if (!PacketReadUpdateWorld(reader, &header))
+		return false;
+
+	uint32_t tick = header.Tick;
+	uint32_t baseTick = header.BaseTick;
+	uint8_t present = header.Present;
+
+	// start from the baseline, a full snapshot starts from nothing
+	const WorldSnapshot* baseline = NULL;
+	if (baseTick != 0)
+	{
+		baseline = FindSnapshot(history, baseTick);
+		if (baseline == NULL)
+			return false;
+		*world = *baseline;
+	}
+	else
+	{
+		memset(world, 0, sizeof(WorldSnapshot));
+	}
+
+	world->Tick = tick;
+	world->Present = present;
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (!(present & (1 << i)))
+			continue;
+
+		uint8_t fields = PacketReadByte(reader);
+
+		// a car that was not in the baseline must be sent in full, otherwise we'd be using someone else's old data
+		if ((baseline == NULL || !(baseline->Present & (1 << i))) && (fields & CarFieldAll) != CarFieldAll)
+			return false;
+
+		ReadCarDelta(reader, &world->Cars[i], fields);
+	}
+
+	// the reader zeroes anything past the end, so one check at the end catches a short message
+	return !reader->Overflow;
+}
@@ -0,0 +1,82 @@
+// a lock free queue between exactly two threads
+
+#include "net_spsc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// the item has to be written before the producer moves the tail past it, and read before the consumer moves the head past it
+// so the index the other thread writes is read with acquire, and our own index is published with release
+#if defined(_MSC_VER)
+
+#include <intrin.h>
+
+// the interlocked functions are full barriers, which is more than we need but works on every windows cpu
+static uint32_t LoadAcquire(volatile uint32_t* value)
+{
+	return (uint32_t)_InterlockedCompareExchange((volatile long*)value, 0, 0);
+}
+
+static void StoreRelease(volatile uint32_t* value, uint32_t newValue)
+{
+	_InterlockedExchange((volatile long*)value, (long)newValue);
+}
+
+#else
+
+static uint32_t LoadAcquire(volatile uint32_t* value)
+{
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void StoreRelease(volatile uint32_t* value, uint32_t newValue)
+{
+	__atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+#endif
+
+bool SpscInit(SpscRing* ring, uint32_t itemSize, uint32_t capacity)
+{
+	memset(ring, 0, sizeof(SpscRing));
+
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+		return false;
+
+	ring->Items = (uint8_t*)malloc((size_t)itemSize * capacity);
+	if (ring->Items == NULL)
+		return false;
+
+	ring->ItemSize = itemSize;
+	ring->Capacity = capacity;
+	return true;
+}
+
+void SpscFree(SpscRing* ring)
+{
+	free(ring->Items);
+	memset(ring, 0, sizeof(SpscRing));
+}
+
+bool SpscPush(SpscRing* ring, const void* item)
+{
+	// the indexes count up forever and wrap around, so head == tail is empty and tail - head == capacity is full
+	uint32_t tail = ring->Tail;
+	if (tail - LoadAcquire(&ring->Head) == ring->Capacity)
+		return false;
+
+	memcpy(ring->Items + (size_t)(tail & (ring->Capacity - 1)) * ring->ItemSize, item, ring->ItemSize);
+	StoreRelease(&ring->Tail, tail + 1);
+	return true;
+}
+
+bool SpscPop(SpscRing* ring, void* item)
+{
+	uint32_t head = ring->Head;
+	if (head == LoadAcquire(&ring->Tail))
+		return false;
+
+	memcpy(item, ring->Items + (size_t)(head & (ring->Capacity - 1)) * ring->ItemSize, ring->ItemSize);
+	StoreRelease(&ring->Head, head + 1);
+	return true;
+}
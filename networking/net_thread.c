@@ -0,0 +1,116 @@
+// a minimal thread wrapper
+
+#include "net_thread.h"
+
+#include <stdlib.h>
+
+// what the new thread needs to call the function it was given
+typedef struct
+{
+	NetThreadFunction Function;
+	void* Arg;
+}ThreadStart;
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+static DWORD WINAPI ThreadMain(LPVOID param)
+{
+	ThreadStart start = *(ThreadStart*)param;
+	free(param);
+	start.Function(start.Arg);
+	return 0;
+}
+
+bool StartThread(NetThread* thread, NetThreadFunction function, void* arg)
+{
+	ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+	if (start == NULL)
+		return false;
+
+	start->Function = function;
+	start->Arg = arg;
+
+	thread->Handle = CreateThread(NULL, 0, ThreadMain, start, 0, NULL);
+	if (thread->Handle == NULL)
+	{
+		free(start);
+		return false;
+	}
+	return true;
+}
+
+void JoinThread(NetThread* thread)
+{
+	if (thread->Handle == NULL)
+		return;
+
+	WaitForSingleObject((HANDLE)thread->Handle, INFINITE);
+	CloseHandle((HANDLE)thread->Handle);
+	thread->Handle = NULL;
+}
+
+void SleepThread(int milliseconds)
+{
+	Sleep((DWORD)milliseconds);
+}
+
+#else
+
+#include <pthread.h>
+#include <time.h>
+
+static void* ThreadMain(void* param)
+{
+	ThreadStart start = *(ThreadStart*)param;
+	free(param);
+	start.Function(start.Arg);
+	return NULL;
+}
+
+bool StartThread(NetThread* thread, NetThreadFunction function, void* arg)
+{
+	ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+	pthread_t* handle = (pthread_t*)malloc(sizeof(pthread_t));
+	if (start == NULL || handle == NULL)
+	{
+		free(start);
+		free(handle);
+		return false;
+	}
+
+	start->Function = function;
+	start->Arg = arg;
+
+	if (pthread_create(handle, NULL, ThreadMain, start) != 0)
+	{
+		free(start);
+		free(handle);
+		thread->Handle = NULL;
+		return false;
+	}
+
+	thread->Handle = handle;
+	return true;
+}
+
+void JoinThread(NetThread* thread)
+{
+	if (thread->Handle == NULL)
+		return;
+
+	pthread_join(*(pthread_t*)thread->Handle, NULL);
+	free(thread->Handle);
+	thread->Handle = NULL;
+}
+
+void SleepThread(int milliseconds)
+{
+	struct timespec wait;
+	wait.tv_sec = milliseconds / 1000;
+	wait.tv_nsec = (long)(milliseconds % 1000) * 1000000;
+	nanosleep(&wait, NULL);
+}
+
+#endif
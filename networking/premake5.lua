@@ -13,6 +13,19 @@ project (baseName)
     }
     files {"**.hpp", "**.h", "**.cpp","**.c"}
 
+    -- every memory backend is built, the define picks the one memory.c uses when SCUD_MEMORY is not set
+    memoryBackend = _OPTIONS["memory"]
+    if (memoryBackend == nil) then
+        if (os.target() == "windows") then
+            memoryBackend = "win32"
+        elseif (os.target() == "linux") then
+            memoryBackend = "linux"
+        end
+    end
+    if (memoryBackend ~= nil) then
+        defines { "MEM_BACKEND_" .. string.upper(memoryBackend) }
+    end
+
     includedirs { "./" }
     includedirs { "./include" }
     include_raylib()
\ No newline at end of file
@@ -13,6 +13,19 @@ newoption
     default = "opengl33"
 }
 
+newoption
+{
+    trigger = "memory",
+    value = "BACKEND",
+    description = "how the client reaches the emulator's memory by default, SCUD_MEMORY picks another at startup",
+    allowed = {
+        { "win32", "ReadProcessMemory/WriteProcessMemory"},
+        { "linux", "process_vm_readv/process_vm_writev"},
+        { "shm", "map the RAM a cooperating emulator shares"},
+        { "array", "a byte array in the client, no emulator"}
+    }
+}
+
 function string.starts(String,Start)
     return string.sub(String,1,string.len(Start))==Start
 end
@@ -83,6 +96,12 @@ workspace (workspaceName)
 
     cdialect "C11"
     cppdialect "C++17"
+
+    -- msvc only has <stdatomic.h> behind this switch
+    filter "action:vs*"
+        buildoptions { "/experimental:c11atomics" }
+
+    filter {}
 check_raylib();
 
 include ("raylib_premake5.lua")
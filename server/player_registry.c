@@ -0,0 +1,84 @@
+// player registry
+
+#include "player_registry.h"
+
+// a handle is the slot index in the low 16 bits and the slot generation in the high 16 bits
+#define HANDLE_INDEX(handle) ((int)((handle) & 0xFFFF))
+#define HANDLE_GENERATION(handle) ((uint16_t)((handle) >> 16))
+#define MAKE_HANDLE(index, generation) (((PlayerHandle)(generation) << 16) | (PlayerHandle)(index))
+
+void RegistryInit(PlayerRegistry* registry)
+{
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		// generations start at 1 so a handle is never 0
+		registry->Slots[i].Generation = 1;
+		registry->Slots[i].Used = false;
+		registry->Slots[i].NextFree = i + 1 < MAX_PEERS ? i + 1 : -1;
+		registry->Slots[i].Room = NULL;
+		registry->Slots[i].PlayerId = -1;
+	}
+	registry->FreeHead = 0;
+}
+
+PlayerHandle RegistryAdd(PlayerRegistry* registry, Room* room, int playerId)
+{
+	int index = registry->FreeHead;
+	if (index < 0)
+		return INVALID_PLAYER_HANDLE;
+
+	PlayerSlot* slot = &registry->Slots[index];
+	registry->FreeHead = slot->NextFree;
+
+	slot->Used = true;
+	slot->NextFree = -1;
+	slot->Room = room;
+	slot->PlayerId = playerId;
+
+	return MAKE_HANDLE(index, slot->Generation);
+}
+
+Room* RegistryGet(const PlayerRegistry* registry, PlayerHandle handle, int* playerId)
+{
+	int index = HANDLE_INDEX(handle);
+	if (handle == INVALID_PLAYER_HANDLE || index >= MAX_PEERS)
+		return NULL;
+
+	const PlayerSlot* slot = &registry->Slots[index];
+	if (!slot->Used || slot->Generation != HANDLE_GENERATION(handle))
+		return NULL;
+
+	*playerId = slot->PlayerId;
+	return slot->Room;
+}
+
+void RegistryRemove(PlayerRegistry* registry, PlayerHandle handle)
+{
+	int playerId;
+	if (RegistryGet(registry, handle, &playerId) == NULL)
+		return;
+
+	int index = HANDLE_INDEX(handle);
+	PlayerSlot* slot = &registry->Slots[index];
+	slot->Used = false;
+	slot->Room = NULL;
+	slot->PlayerId = -1;
+
+	// skip 0 when the generation wraps so handles stay non zero
+	slot->Generation++;
+	if (slot->Generation == 0)
+		slot->Generation = 1;
+
+	slot->NextFree = registry->FreeHead;
+	registry->FreeHead = index;
+}
+
+PlayerHandle RegistryGetPeerHandle(ENetPeer* peer)
+{
+	return (PlayerHandle)(uintptr_t)enet_peer_get_data(peer);
+}
+
+void RegistryAttach(ENetPeer* peer, PlayerHandle handle)
+{
+	enet_peer_set_data(peer, (const void*)(uintptr_t)handle);
+}
@@ -0,0 +1,61 @@
+// player registry
+// maps enet connections to the room and slot of the player that uses them in constant time.
+// every connection gets a handle made of a registry slot index and the generation of that slot, the handle is stored
+// in the peer with enet_peer_set_data. When a player leaves the slot's generation moves on, so a handle left behind
+// in a reused peer, or any other stale handle, no longer matches and is rejected.
+#pragma once
+
+#include "room.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// a reference to a registered player, 0 is never a valid handle
+typedef uint32_t PlayerHandle;
+
+#define INVALID_PLAYER_HANDLE 0
+
+// one registry slot
+typedef struct
+{
+	// bumped every time the slot is freed, handles from before that don't match anymore
+	uint16_t Generation;
+
+	bool Used;
+
+	// the next free slot when this one is on the free list, -1 for the end of the list
+	int NextFree;
+
+	// where the player is
+	Room* Room;
+	int PlayerId;
+}PlayerSlot;
+
+// every player one server host can have
+typedef struct
+{
+	PlayerSlot Slots[MAX_PEERS];
+
+	// the first free slot, -1 if the registry is full
+	int FreeHead;
+}PlayerRegistry;
+
+// empty the registry and put every slot on the free list
+void RegistryInit(PlayerRegistry* registry);
+
+// register a player and hand back the handle for them
+// returns INVALID_PLAYER_HANDLE if the registry is full
+PlayerHandle RegistryAdd(PlayerRegistry* registry, Room* room, int playerId);
+
+// look up the player for a handle
+// returns the room and fills in the player id, or returns NULL if the handle is stale or invalid
+Room* RegistryGet(const PlayerRegistry* registry, PlayerHandle handle, int* playerId);
+
+// free the slot for a handle, the handle and any copies of it become stale
+void RegistryRemove(PlayerRegistry* registry, PlayerHandle handle);
+
+// the handle stored in a peer by RegistryAttach, INVALID_PLAYER_HANDLE if it has none
+PlayerHandle RegistryGetPeerHandle(ENetPeer* peer);
+
+// store a handle in a peer so the next lookups don't need to search
+void RegistryAttach(ENetPeer* peer, PlayerHandle handle);
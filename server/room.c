@@ -0,0 +1,347 @@
+// race rooms
+
+#include "room.h"
+#include "net_messages.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// sends a player everything in their outbox as one reliable packet
+static bool FlushControl(PlayerInfo* player)
+{
+	ENetPacket* packet = BatchEnd(&player->Outbox);
+	if (packet == NULL)
+		return false;
+
+	enet_peer_send(player->Peer, CHANNEL_CONTROL, packet);
+	return true;
+}
+
+// queues a control message for a player, it goes out with the next tick along with everything else queued for them
+static void QueueControl(PlayerInfo* player, const uint8_t* message, size_t size)
+{
+	// a full outbox goes out early rather than losing the message
+	if (!BatchAppend(&player->Outbox, message, size, ENET_PACKET_FLAG_RELIABLE))
+	{
+		FlushControl(player);
+		BatchAppend(&player->Outbox, message, size, ENET_PACKET_FLAG_RELIABLE);
+	}
+}
+
+// queues a control message for every active player in the room, except the one specified (usually the sender)
+// senders know what they sent so you can choose to not send them data they already know.
+// in a truly authoritative server you'd send back an acceptance message to all client input so they know it wasn't rejected.
+static void QueueToAllBut(Room* room, const uint8_t* message, size_t size, int exceptPlayerId)
+{
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (!room->Players[i].Active || i == exceptPlayerId)
+			continue;
+
+		QueueControl(&room->Players[i], message, size);
+	}
+}
+
+static void QueueToAll(Room* room, const uint8_t* message, size_t size)
+{
+	QueueToAllBut(room, message, size, -1);
+}
+
+static int GetActivePlayers(Room* room)
+{
+	int players = 0;
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (room->Players[i].Active == true)
+			players++;
+	}
+	return players;
+}
+
+static int GetReadyPlayers(Room* room)
+{
+	int players = 0;
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (room->Players[i].Active && room->Players[i].State == 1)
+			players++;
+	}
+	return players;
+}
+
+// once everyone in the room is ready, start the race
+static void CheckRaceStart(Room* room)
+{
+	if (room->GameState == RoomRacing)
+		return;
+
+	int active = GetActivePlayers(room);
+	int ready = GetReadyPlayers(room);
+	if ((active == ready) && (active > 1))
+	{
+		room->GameState = RoomRacing;
+		printf("Room %d Race Start !\n", room->Id);
+		RaceStartMessage start = { 0 };
+		uint8_t message[RaceStartMessageSize];
+		EncodeRaceStart(&start, message);
+		QueueToAll(room, message, sizeof(message));
+	}
+}
+
+Room* FindOpenRoom(Room* rooms, int roomCount, int capacity)
+{
+	// fill up rooms that are waiting for players before opening new ones
+	Room* unused = NULL;
+	for (int i = 0; i < roomCount; i++)
+	{
+		Room* room = &rooms[i];
+		if (!room->Active)
+		{
+			if (unused == NULL)
+				unused = room;
+			continue;
+		}
+
+		if (room->Capacity == capacity && room->GameState != RoomRacing && GetActivePlayers(room) < capacity)
+			return room;
+	}
+	return unused;
+}
+
+int RoomAddPlayer(Room* room, ENetPeer* peer, int capacity)
+{
+	// the first player opens the room with a clean slate
+	if (!room->Active)
+	{
+		int id = room->Id;
+		memset(room, 0, sizeof(Room));
+		room->Id = id;
+		room->Active = true;
+		room->Capacity = capacity;
+	}
+
+	// find an empty slot
+	int playerId = 0;
+	for (; playerId < room->Capacity; playerId++)
+	{
+		if (!room->Players[playerId].Active)
+			break;
+	}
+
+	// we are full
+	if (playerId == room->Capacity)
+		return -1;
+
+	// player is good, don't give away the slot
+	memset(&room->Players[playerId], 0, sizeof(PlayerInfo));
+	room->Players[playerId].Active = true;
+
+	// but don't send out an update to everyone until they give us a good position
+	room->Players[playerId].ValidPosition = false;
+	room->Players[playerId].Peer = peer;
+
+	// they don't have any snapshots yet, so the first one they get will be a full one
+	room->Players[playerId].LastAckedTick = 0;
+
+	// pack up a message to send back to the client to tell them they have been accepted as a player
+	// with the player ID so they know who they are
+	// it goes out with the next tick, in the same packet as the add messages below
+	AcceptPlayerMessage accept = { 0 };
+	accept.PlayerId = (uint8_t)playerId;
+	uint8_t acceptMessage[AcceptPlayerMessageSize];
+	EncodeAcceptPlayer(&accept, acceptMessage);
+	QueueControl(&room->Players[playerId], acceptMessage, sizeof(acceptMessage));
+
+	// We have to tell the new client about all the other players that are already in the room
+	// so send them an add message for all existing active players.
+	// their positions will arrive with the next world snapshot
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		// only people who are valid and not the new player
+		if (i == playerId || !room->Players[i].Active || !room->Players[i].ValidPosition)
+			continue;
+
+		// pack up an add player message with the ID
+		// Optimally we'd also send other info like name, color, and other static player info.
+		AddPlayerMessage add = { 0 };
+		add.PlayerId = (uint8_t)i;
+		uint8_t addMessage[AddPlayerMessageSize];
+		EncodeAddPlayer(&add, addMessage);
+		QueueControl(&room->Players[playerId], addMessage, sizeof(addMessage));
+	}
+
+	return playerId;
+}
+
+void RoomHandleCommand(Room* room, int playerId, ENetPacket* packet)
+{
+	PlayerInfo* player = &room->Players[playerId];
+
+	// the reader keeps track of how far into the message we are
+	PacketReader reader;
+	BeginRead(&reader, packet);
+
+	// see what the client wants us to do, the message itself is read by the command it is
+	NetworkCommands command = (NetworkCommands)(packet->dataLength > 0 ? packet->data[0] : 0);
+
+	if (command == UpdateInput)
+	{
+		// update the location data with the new info
+		// nothing is sent here, the next server tick folds this into the world snapshot
+		// the car comes packed (net_car_codec.h), it stays on the codec's steps so snapshots send it on unchanged
+		// a short message would leave the car at the origin, keep the last good position instead
+		UpdateInputMessage input;
+		if (!PacketReadUpdateInput(&reader, &input))
+			return;
+
+		player->X = input.Car.X;
+		player->Y = input.Car.Y;
+		player->Z = input.Car.Z;
+		player->Pitch = input.Car.Pitch;
+		player->Yaw = input.Car.Yaw;
+		player->Speed = input.Car.Speed;
+		player->BrakeLight = input.Car.BrakeLight;
+		player->Car = input.Car.Car;
+		player->CarNumber = input.Car.CarNumber;
+		player->SampleTime = input.SampleTime;
+		player->ReceiveTime = NetTimeMicros();
+		player->NewInput = true;
+
+		// if they are new, tell everyone else to add them before their first snapshot shows up
+		if (!player->ValidPosition)
+		{
+			AddPlayerMessage add = { 0 };
+			add.PlayerId = (uint8_t)playerId;
+			uint8_t message[AddPlayerMessageSize];
+			EncodeAddPlayer(&add, message);
+			QueueToAllBut(room, message, sizeof(message), playerId);
+		}
+
+		// the player has sent us a position, they can be part of future snapshots
+		player->ValidPosition = true;
+	}
+	else if (command == AckWorld)
+	{
+		// acks can arrive out of order, only ever move forward
+		AckWorldMessage ack;
+		if (PacketReadAckWorld(&reader, &ack) && ack.Tick > player->LastAckedTick && ack.Tick <= room->ServerTick)
+			player->LastAckedTick = ack.Tick;
+	}
+	else if (command == PlayerIsReady)
+	{
+		player->State = 1;
+		if (playerId == 0)
+		{
+			room->GameState = RoomMasterReady;
+			printf("Room %d Master is Ready ! %d \n", room->Id, room->GameState);
+			MasterIsReadyMessage ready = { 0 };
+			uint8_t message[MasterIsReadyMessageSize];
+			EncodeMasterIsReady(&ready, message);
+			QueueToAllBut(room, message, sizeof(message), playerId);
+		}
+	}
+
+	CheckRaceStart(room);
+}
+
+void RoomRemovePlayer(Room* room, int playerId)
+{
+	// mark them as inactive and clear the peer pointer, anything still queued for them has nowhere to go
+	room->Players[playerId].Active = false;
+	room->Players[playerId].ValidPosition = false;
+	room->Players[playerId].Peer = NULL;
+	BatchClear(&room->Players[playerId].Outbox);
+
+	// the last one out closes the room so it can be used for a new race
+	if (GetActivePlayers(room) == 0)
+	{
+		room->Active = false;
+		return;
+	}
+
+	// Tell everyone that someone left
+	RemovePlayerMessage remove = { 0 };
+	remove.PlayerId = (uint8_t)playerId;
+	uint8_t message[RemovePlayerMessageSize];
+	EncodeRemovePlayer(&remove, message);
+	QueueToAll(room, message, sizeof(message));
+
+	// the player that left may have been the only one holding up the start
+	CheckRaceStart(room);
+}
+
+bool RoomTick(Room* room)
+{
+	// the control messages go first, a player who was just added hears about it before their first snapshot
+	// NOTE enet_host_service will handle releasing send packets when the network system has finally sent them,
+	// you don't have to destroy them
+	bool sent = false;
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (room->Players[i].Active)
+			sent |= FlushControl(&room->Players[i]);
+	}
+
+	room->ServerTick++;
+	uint64_t now = NetTimeMicros();
+
+	WorldSnapshot* world = StoreSnapshot(&room->WorldHistory, room->ServerTick);
+	world->Present = 0;
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		PlayerInfo* player = &room->Players[i];
+		if (!player->Active || !player->ValidPosition)
+			continue;
+
+		world->Present |= (uint8_t)(1 << i);
+		world->Cars[i].X = player->X;
+		world->Cars[i].Y = player->Y;
+		world->Cars[i].Z = player->Z;
+		world->Cars[i].Pitch = player->Pitch;
+		world->Cars[i].Yaw = player->Yaw;
+		world->Cars[i].Speed = player->Speed;
+		world->Cars[i].BrakeLight = player->BrakeLight;
+		world->Cars[i].Car = player->Car;
+		world->Cars[i].CarNumber = player->CarNumber;
+
+		// the relay delay only changes with a new input, so a car that didn't move doesn't have to be sent again
+		if (player->NewInput)
+		{
+			uint64_t held = (now - player->ReceiveTime) / SNAPSHOT_RELAY_UNIT;
+			player->RelayDelay = (uint16_t)(held < UINT16_MAX ? held : UINT16_MAX);
+			player->NewInput = false;
+		}
+		world->Cars[i].SampleTime = player->SampleTime;
+		world->Cars[i].RelayDelay = player->RelayDelay;
+	}
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (!room->Players[i].Active)
+			continue;
+
+		// each player gets their own delta, without their own car since they already know where they are
+		// players that never acknowledged anything, or whose acknowledgment is too old to be in the history, get the full snapshot.
+		const WorldSnapshot* baseline = FindSnapshot(&room->WorldHistory, room->Players[i].LastAckedTick);
+		SnapshotDelta delta;
+
+		// they already have all of this
+		if (!PrepareWorldSnapshot(&delta, world, baseline, i, room->Players[i].WantsTiming))
+			continue;
+
+		// snapshots are unreliable, if one is lost the next one is encoded against what they did get
+		PacketWriter writer;
+		if (!BeginPacket(&writer, delta.Size, 0))
+			continue;
+
+		WriteWorldSnapshot(&writer, world, baseline, &delta);
+		ENetPacket* packet = EndPacket(&writer);
+		if (packet == NULL)
+			continue;
+
+		enet_peer_send(room->Players[i].Peer, CHANNEL_STATE, packet);
+		sent = true;
+	}
+
+	return sent;
+}
@@ -0,0 +1,136 @@
+// race rooms
+// every room is one race with up to MAX_PLAYERS players and its own lifecycle (ready, master is ready, race start)
+// the server hosts many rooms on the same host and routes every command to the room of the player that sent it
+#pragma once
+
+#include "net_common.h"
+#include "net_snapshot.h"
+#include "net_batch.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// how many races one server host can run at the same time
+// enet can't have more than 4095 peers on a host, so this times MAX_PLAYERS has to stay under that
+#define MAX_ROOMS 500
+
+// how many connections a server host accepts
+#define MAX_PEERS (MAX_ROOMS * MAX_PLAYERS)
+
+// the info we are tracking about each player in the game
+typedef struct
+{
+	// is this player slot active
+	bool Active;
+
+	//
+	bool State;
+
+	// have they sent us a valid position yet?
+	bool ValidPosition;
+
+	// the network connection they use
+	ENetPeer* Peer;
+
+	// control messages for them that go out together with the next tick
+	MessageBatch Outbox;
+
+	// the newest world snapshot they told us they have, 0 if they don't have one yet
+	uint32_t LastAckedTick;
+
+	// do they want the timing of every car in their snapshots
+	bool WantsTiming;
+
+	// when they sent their last input, by their clock, and when it got here, by ours
+	uint32_t SampleTime;
+	uint64_t ReceiveTime;
+
+	// has an input arrived since the last snapshot
+	bool NewInput;
+
+	// how long the server held their last input before it went into a snapshot
+	uint16_t RelayDelay;
+
+	//
+	uint8_t Car;
+
+	uint8_t CarNumber;
+
+	uint8_t BrakeLight;
+
+	// the last known location in X and Y
+	float X;
+	float Y;
+	float Z;
+
+	float DX;
+	float DY;
+	float DZ;
+
+	float Pitch;
+	float Roll;
+	float Yaw;
+
+	float Speed;
+
+}PlayerInfo;
+
+// the state of a race
+typedef enum
+{
+	// players can join, nobody has loaded the race yet
+	RoomWaiting = 0,
+
+	// player 0 (the master) has loaded the race, everyone else is unlocked
+	RoomMasterReady = 1,
+
+	// everyone is ready and the race has started, nobody else can join
+	RoomRacing = 2,
+}RoomState;
+
+// one race and everyone in it
+typedef struct
+{
+	// does anyone use this room
+	bool Active;
+
+	// the number we print in the log for this room, unique across every worker
+	int Id;
+
+	RoomState GameState;
+
+	// how many players this race is for, only players who asked for the same race size are put in it
+	int Capacity;
+
+	// the number of the last world snapshot we took for this room
+	uint32_t ServerTick;
+
+	// the world as it was on the most recent ticks, used as the baselines for delta encoding
+	SnapshotHistory WorldHistory;
+
+	// The list of all possible players
+	// this is the server state of the race that represents the current game state
+	// this is what server code would check to see where all the players are and what they are doing
+	PlayerInfo Players[MAX_PLAYERS];
+}Room;
+
+// finds a room in a table a new player can join, a room of the right size that is waiting for players if there is one,
+// otherwise an unused room
+// returns NULL if every room is full or racing
+Room* FindOpenRoom(Room* rooms, int roomCount, int capacity);
+
+// gives a new connection a player slot in the room and tells them who is already there
+// an unused room is opened for capacity players
+// returns the player id, or -1 if the room is full
+int RoomAddPlayer(Room* room, ENetPeer* peer, int capacity);
+
+// processes a command a player in the room sent us
+void RoomHandleCommand(Room* room, int playerId, ENetPacket* packet);
+
+// takes a player out of the room and tells everyone else they left
+void RoomRemovePlayer(Room* room, int playerId);
+
+// sends every player the control messages queued for them since the last tick, then takes a snapshot of the room
+// and sends every player what changed since their last ack
+// returns true if anything was sent
+bool RoomTick(Room* room);
@@ -30,376 +30,355 @@
 
 #define ENET_IMPLEMENTATION
 #include "net_common.h"
+#include "net_thread.h"
+#include "net_pool.h"
+#include "room.h"
+#include "player_registry.h"
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <stdbool.h>
 
-// the info we are tracking about each player in the game
+// how many world snapshots the server sends every second when no rate is given on the command line
+#define DEFAULT_TICK_RATE 30
+
+// the most worker threads the server will start
+#define MAX_WORKERS 64
+
+// the port every worker listens on
+#define SERVER_PORT 4545
+
+// how often every worker prints how well its packet pool is doing, in milliseconds
+#define POOL_STATS_INTERVAL 10000
+
+// one server loop with its own host and its own rooms
+// workers never touch each other's rooms, so nothing on the hot path needs a lock.
+// with more than one worker every host binds the same port with SO_REUSEPORT and the kernel spreads the clients over them,
+// always sending the same client address to the same worker
 typedef struct
 {
-	// is this player slot active
-	bool Active;
+	int Index;
 
-	//
-	bool State;
+	ENetHost* Host;
 
-	// have they sent us a valid position yet?
-	bool ValidPosition;
+	// this worker's rooms, a player is only ever put in a room of the worker that accepted their connection
+	Room* Rooms;
+	int RoomCount;
 
-	// the network connection they use
-	ENetPeer* Peer;
+	// finds the room and slot of the player behind each of this worker's connections
+	PlayerRegistry* Registry;
 
-	//
-	uint8_t Car;
+	int TickRate;
 
-	uint8_t CarNumber;
+	NetThread Thread;
+}ServerWorker;
 
-	uint8_t BrakeLight;
+// the server will run forever. If we wanted a way to stop it, we'd set run to false using some code
+volatile bool Run = true;
 
-	// the last known location in X and Y
-	float X;
-	float Y;
-	float Z;
+// finds the room and the player slot that goes with the player connection
+// the peer carries the handle we gave it when it connected, a stale or missing handle means the connection is not a player
+Room* FindPlayer(ServerWorker* worker, ENetPeer* peer, int* playerId)
+{
+	Room* room = RegistryGet(worker->Registry, RegistryGetPeerHandle(peer), playerId);
 
-	float DX;
-	float DY;
-	float DZ;
+	// the slot has to still belong to this connection
+	if (room == NULL || !room->Players[*playerId].Active || room->Players[*playerId].Peer != peer)
+		return NULL;
 
-	float Pitch;
-	float Roll;
-	float Yaw;
+	return room;
+}
 
-	float Speed;
+// process one network event from enet, every event is routed to the room of the player it is about
+void HandleEvent(ServerWorker* worker, ENetEvent* event)
+{
+	// see what kind of event we have
+	switch (event->type)
+	{
 
-}PlayerInfo;
+		// a new client is trying to connect
+	case ENET_EVENT_TYPE_CONNECT:
+	{
+		// they tell us how big a race they want when they connect, anything we can't do gets a full race
+		int capacity = (int)(event->data & ROOM_SIZE_MASK);
+		if (capacity == ROOM_SIZE_DEFAULT || capacity < 2 || capacity > MAX_PLAYERS)
+			capacity = MAX_PLAYERS;
 
-int GameState = 0;
+		// find a room with space, or disconnect them if we are full
+		Room* room = FindOpenRoom(worker->Rooms, worker->RoomCount, capacity);
 
+		// we are full
+		if (room == NULL)
+		{
+			// I said good day SIR!
+			enet_peer_disconnect(event->peer, 0);
+			break;
+		}
 
+		int playerId = RoomAddPlayer(room, event->peer, capacity);
 
-// The list of all possible players
-// this is the server state of the game that represents the current game state
-// this is what server code would check to see where all the players are and what they are doing
-PlayerInfo Players[MAX_PLAYERS] = { 0 };
+		// the room had no space after all
+		if (playerId < 0)
+		{
+			enet_peer_disconnect(event->peer, 0);
+			break;
+		}
 
-// finds the player slot that goes with the player connection
-// the peer has the void* ENetPeer::data that can be used to store arbitary application data
-// but that involves managing structure pointers so it is kept out of this example
-int GetPlayerId(ENetPeer* peer)
-{
-	// find the slot that matches the pointer
-	for (int i = 0; i < MAX_PLAYERS; i++)
-	{
-		if (Players[i].Active && Players[i].Peer == peer)
-			return i;
-	}
-	return -1;
-}
+		room->Players[playerId].WantsTiming = (event->data & CONNECT_WANTS_TIMING) != 0;
 
-// sends a packet over the network to every active player, except the one specified (usually the sender)
-// senders know what they sent so you can choose to not send them data they already know.
-// in a truly authoritative server you'd send back an acceptance message to all client input so they know it wasn't rejected.
-void SendToAllBut(ENetPacket* packet, int exceptPlayerId)
-{
-	for (int i = 0; i < MAX_PLAYERS; i++)
-	{
-		if (!Players[i].Active || i == exceptPlayerId)
-			continue;
+		// remember who this connection belongs to, so every packet from them can find their room without searching
+		RegistryAttach(event->peer, RegistryAdd(worker->Registry, room, playerId));
 
-		enet_peer_send(Players[i].Peer, 0, packet);
+		printf("Player %d Connected to room %d\n", playerId, room->Id);
+		break;
 	}
-}
 
-void SendToAll(ENetPacket* packet)
-{
-	for (int i = 0; i < MAX_PLAYERS; i++)
+	// someone sent us data
+	case ENET_EVENT_TYPE_RECEIVE:
 	{
-		if (!Players[i].Active)
-			continue;
+		// find the player who sent the data
+		// we don't need them to send us what ID they are, we know who they are by the peer
+		// we want to trust the client as little as possible so that people can't cheat/hack
+		// if we blindly accepted a player ID, a client could send you updates for someone else :(
+
+		int playerId = -1;
+		Room* room = FindPlayer(worker, event->peer, &playerId);
+		if (room == NULL)
+		{
+			// they are not one of our peeple, boot them
+			enet_peer_disconnect(event->peer, 0);
+		}
+		else
+		{
+			RoomHandleCommand(room, playerId, event->packet);
+		}
 
-		enet_peer_send(Players[i].Peer, 0, packet);
+		// tell enet that it can recycle the inbound packet
+		enet_packet_destroy(event->packet);
+		break;
 	}
-}
-
-int GetActivePlayers()
-{
-	int players = 0;
-	for (int i = 0; i < MAX_PLAYERS; i++)
+	case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
+	case ENET_EVENT_TYPE_DISCONNECT:
 	{
-		if (Players[i].Active == true)
-			players++;
+		// find them if they are a real player
+		int playerId = -1;
+		Room* room = FindPlayer(worker, event->peer, &playerId);
+		if (room == NULL)
+			break;
+
+		// a player was disconnected
+		printf("Player %d Disconnected from room %d\n", playerId, room->Id);
+
+		RoomRemovePlayer(room, playerId);
+
+		// the handle goes stale, so nothing can reach the slot through this peer anymore
+		RegistryRemove(worker->Registry, RegistryGetPeerHandle(event->peer));
+		RegistryAttach(event->peer, INVALID_PLAYER_HANDLE);
+		break;
 	}
-	return players;
-}
 
-int GetReadyPlayers()
-{
-	int players = 0;
-	for (int i = 0; i < MAX_PLAYERS; i++)
-	{
-		if (Players[i].State == 1)
-			players++;
+	case ENET_EVENT_TYPE_NONE:
+		break;
 	}
-	return players;
 }
 
-// the main server loop
-int main()
+// create the host for a worker
+// network servers must 'listen' on an interface and a port
+// this code sets up enet to listen on any available interface and using our port
+// the client must use the same port as the server and know the address of the server
+ENetHost* CreateServerHost(bool sharePort)
 {
-	printf("Startup\n");
+	ENetAddress address = { 0 };
+	address.host = ENET_HOST_ANY;
+	address.port = SERVER_PORT;
 
-	// set up networking
-	if (enet_initialize() != 0)
-		return 1;
+	if (!sharePort)
+		return enet_host_create(&address, MAX_PEERS, CHANNEL_COUNT, 0, 0);
 
-	printf("Initialized\n");
+#if defined(SO_REUSEPORT)
+	// let enet make an unbound socket, so we can allow the port to be shared before binding it
+	ENetHost* host = enet_host_create(NULL, MAX_PEERS, CHANNEL_COUNT, 0, 0);
+	if (host == NULL)
+		return NULL;
 
-	// network servers must 'listen' on an interface and a port
-	// this code sets up enet to listen on any available interface and using our port
-	// the client must use the same port as the server and know the address of the server
-	ENetAddress address = { 0 };
-	address.host = ENET_HOST_ANY;
-	address.port = 4545;
+	int reuse = 1;
+	if (setsockopt(host->socket, SOL_SOCKET, SO_REUSEPORT, (const char*)&reuse, sizeof(reuse)) != 0 || enet_socket_bind(host->socket, &address) < 0)
+	{
+		enet_host_destroy(host);
+		return NULL;
+	}
+
+	enet_socket_get_address(host->socket, &host->address);
+	return host;
+#else
+	return NULL;
+#endif
+}
 
-	// create the server host
-	ENetHost* server = enet_host_create(&address, MAX_PLAYERS, 1, 0, 0);
+// the pool counters are per thread, so every worker prints its own
+static void PrintPoolStats(ServerWorker* worker)
+{
+	NetPoolStats stats;
+	NetPoolGetStats(&stats);
 
-	if (server == NULL)
-		return 1;
+	uint64_t pooled = stats.Hits + stats.Misses;
+	double hitRate = pooled > 0 ? (100.0 * (double)stats.Hits / (double)pooled) : 0.0;
+	printf("Worker %d pool: %.1f%% hits, %llu misses, %llu large, %llu released, %llu cached\n", worker->Index, hitRate,
+		(unsigned long long)stats.Misses, (unsigned long long)stats.Large, (unsigned long long)stats.Released, (unsigned long long)stats.Cached);
+}
 
-	printf("Created\n");
+// the loop every worker runs
+void WorkerMain(void* arg)
+{
+	ServerWorker* worker = (ServerWorker*)arg;
 
-	// the server will run forever. If we wanted a way to stop it, we'd set run to false using some code
-	bool run = true;
+	// ticks are scheduled from a fixed start time so rates that don't divide 1000ms evenly don't drift
+	uint32_t startTime = enet_time_get();
+	uint64_t tickCount = 0;
+	uint32_t nextTick = startTime;
+	uint32_t nextStats = startTime + POOL_STATS_INTERVAL;
 
-	while (run)
+	while (Run)
 	{
-		ENetEvent event = { 0 };
-		// see if there are any inbound network events, wait up to 1000ms before returning.
-		// if the server also did game logic, this timeout should be lowered
+		// sleep in enet until either a network event shows up or it is time for the next tick
+		uint32_t now = enet_time_get();
+		uint32_t timeout = ENET_TIME_LESS(now, nextTick) ? ENET_TIME_DIFFERENCE(nextTick, now) : 0;
 
-		if (enet_host_service(server, &event, 500) > 0)
+		ENetEvent event = { 0 };
+		if (enet_host_service(worker->Host, &event, timeout) > 0)
 		{
-			// see what kind of event we have
-			switch (event.type)
+			// handle everything that arrived, not just the first event, so a busy server doesn't fall behind the tick
+			do
 			{
+				HandleEvent(worker, &event);
+			} while (enet_host_check_events(worker->Host, &event) > 0);
+		}
 
-				// a new client is trying to connect
-			case ENET_EVENT_TYPE_CONNECT:
+		now = enet_time_get();
+		if (ENET_TIME_GREATER_EQUAL(now, nextTick))
+		{
+			bool sent = false;
+			for (int i = 0; i < worker->RoomCount; i++)
 			{
-				printf("Player Connected\n");
-
-				// find an empty slot, or disconnect them if we are full
-				int playerId = 0;
-				for (; playerId < MAX_PLAYERS; playerId++)
-				{
-					if (!Players[playerId].Active)
-						break;
-				}
-
-				// we are full
-				if (playerId == MAX_PLAYERS)
-				{
-					// I said good day SIR!
-					enet_peer_disconnect(event.peer, 0);
-					break;
-				}
-
-				// player is good, don't give away the slot
-				Players[playerId].Active = true;
-
-				// but don't send out an update to everyone until they give us a good position
-				Players[playerId].ValidPosition = false;
-				Players[playerId].Peer = event.peer;
-
-				// pack up a message to send back to the client to tell them they have been accepted as a player
-				uint8_t buffer[2] = { 0 };
-				buffer[0] = (uint8_t)AcceptPlayer;  // command for the client
-				buffer[1] = (uint8_t)playerId;      // the player ID so they know who they are
-
-				// copy the buffer into an enet packet (TODO : add write functions to go directly to a packet)
-				ENetPacket* packet = enet_packet_create(buffer, 2, ENET_PACKET_FLAG_RELIABLE);
-				// send the data to the user
-				enet_peer_send(event.peer, 0, packet);
-
-				// We have to tell the new client about all the other players that are already on the server
-				// so send them an add message for all existing active players.
-				for (int i = 0; i < MAX_PLAYERS; i++)
-				{
-					// only people who are valid and not the new player
-					if (i == playerId || !Players[i].ValidPosition)
-						continue;
-
-					// pack up an add player message with the ID and the last known position
-					uint8_t addBuffer[2] = { 0 };
-					addBuffer[0] = (uint8_t)AddPlayer;
-					addBuffer[1] = (uint8_t)i;
-					//*(float*)(addBuffer + 2) = (float)Players[i].X;
-					//*(float*)(addBuffer + 6) = (float)Players[i].Y;
-					//*(float*)(addBuffer + 10) = (float)Players[i].Z;
-					//*(float*)(addBuffer + 14) = (float)Players[i].Pitch;
-					//*(float*)(addBuffer + 18) = (float)Players[i].Yaw;
-					//*(float*)(addBuffer + 22) = (float)Players[i].Speed;
-					//addBuffer[26] = (uint8_t)Players[i].BrakeLight;
-					//addBuffer[27] = (uint8_t)Players[i].Car;
-					//addBuffer[28] = (uint8_t)Players[i].CarNumber;
-
-
-
-					// Optimally we'd also send other info like name, color, and other static player info.
-
-					// copy and send the message
-					packet = enet_packet_create(addBuffer, 2, ENET_PACKET_FLAG_RELIABLE);
-					enet_peer_send(event.peer, 0, packet);
-
-					// NOTE enet_host_service will handle releasing send packets when the network system has finally sent them,
-					// you don't have to destroy them
-				}
-				break;
+				if (worker->Rooms[i].Active)
+					sent |= RoomTick(&worker->Rooms[i]);
 			}
 
-			// someone sent us data
-			case ENET_EVENT_TYPE_RECEIVE:
+			// push the snapshots onto the wire now instead of waiting for the next service call
+			if (sent)
+				enet_host_flush(worker->Host);
+
+			// if we stalled for more than a tick, skip the missed ones rather than bursting to catch up
+			tickCount++;
+			nextTick = startTime + (uint32_t)((tickCount * 1000) / worker->TickRate);
+			if (ENET_TIME_LESS(nextTick, now))
 			{
-				// find the player who sent the data
-				// we don't need them to send us what ID they are, we know who they are by the peer
-				// we want to trust the client as little as possible so that people can't cheat/hack
-				// if we blindly accepted a player ID, a client could send you updates for someone else :(
-
-				int playerId = GetPlayerId(event.peer);
-				if (playerId == -1)
-				{
-					// they are not one of our peeple, boot them
-					enet_peer_disconnect(event.peer, 0);
-					break;
-				}
-
-				// keep track of how far into the message we are
-				size_t offset = 0;
-
-				// read off the command the client wants us to process
-				NetworkCommands command = ReadByte(event.packet, &offset);
-
-				// we only accept one message from clients for now, so make sure this is what it is
-				if (command == UpdateInput)
-				{
-					// update the location data with the new info
-					Players[playerId].X = ReadFloat(event.packet, &offset);
-					Players[playerId].Y = ReadFloat(event.packet, &offset);
-					Players[playerId].Z = ReadFloat(event.packet, &offset);
-					Players[playerId].Pitch = ReadFloat(event.packet, &offset);
-					Players[playerId].Yaw = ReadFloat(event.packet, &offset);
-					Players[playerId].Speed = ReadFloat(event.packet, &offset);
-					Players[playerId].BrakeLight = ReadByte(event.packet, &offset);
-					Players[playerId].Car = ReadByte(event.packet, &offset);
-					Players[playerId].CarNumber = ReadByte(event.packet, &offset);
-
-					// lets tell everyone about this new location
-					NetworkCommands outboundCommand = UpdatePlayer;
-
-					// if they are new, send this update as an add player instead of an update
-					if (!Players[playerId].ValidPosition)
-						outboundCommand = AddPlayer;
-
-					// the player has sent us a position, they can be part of future regular updates
-					Players[playerId].ValidPosition = true;
-
-					// pack up the update message with command, player and position
-					uint8_t buffer[35] = { 0 };
-					buffer[0] = (uint8_t)outboundCommand;
-					buffer[1] = (uint8_t)playerId;
-					*(float*)(buffer + 2) = (float)Players[playerId].X;
-					*(float*)(buffer + 6) = (float)Players[playerId].Y;
-					*(float*)(buffer + 10) = (float)Players[playerId].Z;
-					*(float*)(buffer + 14) = (float)Players[playerId].Pitch;
-					*(float*)(buffer + 18) = (float)Players[playerId].Yaw;
-					*(float*)(buffer + 22) = (float)Players[playerId].Speed;
-					buffer[26] = (uint8_t)Players[playerId].BrakeLight;
-					buffer[27] = (uint8_t)Players[playerId].Car;
-					buffer[28] = (uint8_t)Players[playerId].CarNumber;
-
-
-					// Copy and send the data to everyone but the player who sent it  (TODO : add write functions to go directly to a packet)
-					ENetPacket* packet = enet_packet_create(buffer, 35, ENET_PACKET_FLAG_RELIABLE);
-					SendToAllBut(packet, playerId);
-
-					// NOTE enet_host_service will handle releasing send packets when the network system has finally sent them,
-					// you don't have to destroy them
-				}
-				else if (command == PlayerIsReady)
-				{
-					Players[playerId].State = 1;
-					if (playerId == 0)
-					{
-						GameState = 1;
-						printf("Master is Ready ! %d \n", GameState);
-						NetworkCommands outboundCommand = MasterIsReady;
-						uint8_t buffer[2] = { 0 };
-						buffer[0] = (uint8_t)outboundCommand;
-						ENetPacket* packet = enet_packet_create(buffer, 2, ENET_PACKET_FLAG_RELIABLE);
-						SendToAllBut(packet, playerId);
-
-					}
-				}
-
-				// tell enet that it can recycle the inbound packet
-				enet_packet_destroy(event.packet);
-				break;
+				tickCount = ((uint64_t)ENET_TIME_DIFFERENCE(now, startTime) * worker->TickRate) / 1000 + 1;
+				nextTick = startTime + (uint32_t)((tickCount * 1000) / worker->TickRate);
 			}
-			case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
-			case ENET_EVENT_TYPE_DISCONNECT:
-			{
-				// a player was disconnected
-				printf("Player Disconnected\n");
+		}
 
-				// find them if they are a real player
-				int playerId = GetPlayerId(event.peer);
-				if (playerId == -1)
-					break;
+		if (ENET_TIME_GREATER_EQUAL(now, nextStats))
+		{
+			PrintPoolStats(worker);
+			nextStats = now + POOL_STATS_INTERVAL;
+		}
+	}
 
-				// mark them as inactive and clear the peer pointer
-				Players[playerId].Active = false;
-				Players[playerId].Peer = NULL;
+	// hand the blocks this thread kept back to the system
+	NetPoolReleaseThread();
+}
 
-				// Tell everyone that someone left
-				uint8_t buffer[2] = { 0 };
-				buffer[0] = (uint8_t)RemovePlayer;
-				buffer[1] = (uint8_t)playerId;
+// the main server loop
+// usage: server [tick rate in Hz] [worker threads]
+int main(int argc, char** argv)
+{
+	printf("Startup\n");
 
-				// Copy and send the data to everyone but the player who sent it  (TODO : add write functions to go directly to a packet)
-				ENetPacket* packet = enet_packet_create(buffer, 2, ENET_PACKET_FLAG_RELIABLE);
-				SendToAllBut(packet, -1);
+	// how many world snapshots we send every second
+	int tickRate = DEFAULT_TICK_RATE;
+	if (argc > 1)
+		tickRate = atoi(argv[1]);
 
-				// NOTE enet_host_service will handle releasing send packets when the network system has finally sent them,
-				// you don't have to destroy them
+	if (tickRate <= 0 || tickRate > 1000)
+	{
+		printf("Invalid tick rate %s\n", argv[1]);
+		return 1;
+	}
 
-				break;
-			}
+	// how many threads run rooms, each one gets its own host on the same port
+	int workerCount = 1;
+	if (argc > 2)
+		workerCount = atoi(argv[2]);
 
-			case ENET_EVENT_TYPE_NONE:
-				break;
-			}
+	if (workerCount <= 0 || workerCount > MAX_WORKERS)
+	{
+		printf("Invalid worker count %s\n", argv[2]);
+		return 1;
+	}
 
-			int active = GetActivePlayers();
-			int ready = GetReadyPlayers();
-			if ((active == ready) && (active > 1))
-			{
-				Players[0].State = 2;
-				printf("Race Start !\n");
-				NetworkCommands outboundCommand = RaceStart;
-				uint8_t buffer[2] = { 0 };
-				buffer[0] = (uint8_t)outboundCommand;
-				ENetPacket* packet = enet_packet_create(buffer, 2, ENET_PACKET_FLAG_RELIABLE);
-				SendToAll(packet);
-				enet_packet_destroy(event.packet);
-			}
-		}
+#if !defined(SO_REUSEPORT)
+	if (workerCount > 1)
+	{
+		printf("This platform can't share a port between workers, using one worker\n");
+		workerCount = 1;
+	}
+#endif
+
+	// set up networking, with enet allocating its packets and commands out of our pool
+	if (NetPoolInitialize() != 0)
+		return 1;
+
+	printf("Initialized\n");
+
+	// every worker owns MAX_ROOMS rooms, the memory for rooms nobody uses is never touched
+	ServerWorker workers[MAX_WORKERS] = { 0 };
+	for (int w = 0; w < workerCount; w++)
+	{
+		ServerWorker* worker = &workers[w];
+		worker->Index = w;
+		worker->TickRate = tickRate;
+		worker->RoomCount = MAX_ROOMS;
+		worker->Rooms = (Room*)calloc(MAX_ROOMS, sizeof(Room));
+		if (worker->Rooms == NULL)
+			return 1;
+
+		for (int i = 0; i < MAX_ROOMS; i++)
+			worker->Rooms[i].Id = w * MAX_ROOMS + i;
+
+		worker->Registry = (PlayerRegistry*)malloc(sizeof(PlayerRegistry));
+		if (worker->Registry == NULL)
+			return 1;
+
+		RegistryInit(worker->Registry);
+
+		// create the server host
+		worker->Host = CreateServerHost(workerCount > 1);
+		if (worker->Host == NULL)
+			return 1;
 	}
 
+	printf("Created, ticking %d rooms on %d workers at %d Hz\n", workerCount * MAX_ROOMS, workerCount, tickRate);
+
+	// the first worker runs on this thread
+	for (int w = 1; w < workerCount; w++)
+	{
+		if (!StartThread(&workers[w].Thread, WorkerMain, &workers[w]))
+			return 1;
+	}
+	WorkerMain(&workers[0]);
+
 	// cleanup
-	enet_host_destroy(server);
+	for (int w = 0; w < workerCount; w++)
+	{
+		JoinThread(&workers[w].Thread);
+		enet_host_destroy(workers[w].Host);
+		free(workers[w].Rooms);
+		free(workers[w].Registry);
+	}
 	enet_deinitialize();
+	NetPoolReleaseThread();
 
 	return 0;
-}
\ No newline at end of file
+}